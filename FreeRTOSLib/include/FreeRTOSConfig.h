@@ -69,9 +69,11 @@
 
 // And on to the things the same no matter the AVR type...
 #define configUSE_PREEMPTION		    1
+#ifndef configUSE_IDLE_HOOK /* A board may need its own idle hook */
 #define configUSE_IDLE_HOOK		        0
+#endif
 #define configUSE_TICK_HOOK		        0
-#define configMAX_PRIORITIES		    ( ( unsigned portBASE_TYPE ) 5 )
+#define configMAX_PRIORITIES		    ( ( unsigned portBASE_TYPE ) 9 )	/* RoboOne's tasks use every one, see its main.c */
 #define configMINIMAL_STACK_SIZE	    ( ( uint16_t ) 85 )
 #define configMAX_TASK_NAME_LEN		    ( 16 )
 #define configUSE_TRACE_FACILITY	    0
@@ -97,7 +99,9 @@
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
 
 /* Set the stack pointer type to be uint16_t, otherwise it defaults to unsigned long */
+#ifndef portPOINTER_SIZE_TYPE
 #define portPOINTER_SIZE_TYPE			uint16_t
+#endif
 
 /* Set the following definitions to 1 to include the API function, or zero
 to exclude the API function. */
@@ -0,0 +1,472 @@
+/*
+    FreeRTOS V7.5.0 - POSIX (Linux host) port.
+
+    Each task runs in its own pthread.  A thread may only execute while it is
+    the one the kernel has chosen (pxCurrentTCB), every other task thread is
+    parked on its own semaphore.  A separate "interrupt" thread generates the
+    tick and runs simulated interrupt handlers; before it does either it stops
+    the running task with a signal, so that interrupt context never runs
+    concurrently with task context, just as on the real hardware.  Critical
+    sections hold the interrupt thread off rather than excluding other task
+    threads, which can't be running anyway.
+
+    1 tab == 4 spaces!
+*/
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+/*-----------------------------------------------------------
+ * Implementation of functions defined in portable.h for the POSIX port.
+ *----------------------------------------------------------*/
+
+/* The signal used to stop the running task when an interrupt occurs. */
+#define portSUSPEND_SIGNAL					SIGUSR1
+
+/* The tick period in nanoseconds. */
+#define portTICK_PERIOD_NS					( 1000000000L / configTICK_RATE_HZ )
+#define portNANOSECONDS_PER_SECOND			1000000000L
+
+/* The maximum number of simulated interrupts that can be pending at once. */
+#define portMAX_PENDING_INTERRUPTS			16
+
+/* We require the address of the pxCurrentTCB variable, but don't want to know
+any details of its type. */
+typedef void tskTCB;
+extern volatile tskTCB * volatile pxCurrentTCB;
+
+/* Everything the port needs to know about the pthread behind a task.  A
+pointer to this is stored at the top of the task's FreeRTOS stack (which is
+otherwise unused) so that it can be found from the TCB. */
+typedef struct xTHREAD_CONTROL
+{
+	pthread_t xThread;
+	pdTASK_CODE pxCode;
+	void *pvParameters;
+	sem_t xResume;									/* Posted to let the thread run. */
+	volatile sig_atomic_t xRunning;					/* Set by the thread itself once it is actually running. */
+	unsigned portBASE_TYPE uxCriticalNesting;		/* Saved while the thread is switched out. */
+} xThreadControl;
+/*-----------------------------------------------------------*/
+
+/* Protects all of the state below. */
+static pthread_mutex_t xPortMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Signalled to wake the interrupt thread before its next tick is due. */
+static pthread_cond_t xInterruptCondition;
+
+/* Posted by a task thread when it has stopped in response to an interrupt. */
+static sem_t xSuspendedSemaphore;
+
+/* Posted by vPortEndScheduler(). */
+static sem_t xEndSchedulerSemaphore;
+
+/* The task thread that is currently allowed to run. */
+static xThreadControl * volatile pxRunningThread = NULL;
+
+/* Critical nesting of the running task, and the global interrupt mask. */
+static volatile unsigned portBASE_TYPE uxCriticalNesting = 0;
+static volatile portBASE_TYPE xInterruptsDisabled = pdFALSE;
+
+/* Interrupts waiting to be serviced. */
+static unsigned portBASE_TYPE uxPendingTicks = 0;
+static pdINTERRUPT_HANDLER pxPendingInterrupts[ portMAX_PENDING_INTERRUPTS ];
+static unsigned portBASE_TYPE uxNumPendingInterrupts = 0;
+static portBASE_TYPE xYieldFromISRPending = pdFALSE;
+
+/* True only in the interrupt thread. */
+static __thread portBASE_TYPE xIsInterruptContext = pdFALSE;
+/*-----------------------------------------------------------*/
+
+/*
+ * Find the thread behind a TCB.  The first member of the TCB is the top of
+ * stack, which is where pxPortInitialiseStack() left the pointer.
+ */
+static xThreadControl *prvThreadFromTCB( volatile tskTCB *pxTCB )
+{
+portSTACK_TYPE *pxTopOfStack;
+xThreadControl *pxThread;
+
+	pxTopOfStack = *( ( portSTACK_TYPE * volatile * ) pxTCB );
+	memcpy( &pxThread, pxTopOfStack, sizeof( pxThread ) );
+
+	return pxThread;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Park the calling thread until it is next chosen to run.
+ */
+static void prvWaitToRun( xThreadControl *pxThread )
+{
+	while( sem_wait( &( pxThread->xResume ) ) != 0 )
+	{
+		/* Interrupted by a signal before we were resumed, keep waiting. */
+	}
+	pxThread->xRunning = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Hand the processor from one thread to another.  Must be called with
+ * xPortMutex held.  The thread being switched out must park itself
+ * afterwards (or already be parked).
+ */
+static void prvSwitchThreads( xThreadControl *pxFrom, xThreadControl *pxTo )
+{
+	pxFrom->uxCriticalNesting = uxCriticalNesting;
+	pxFrom->xRunning = pdFALSE;
+
+	uxCriticalNesting = pxTo->uxCriticalNesting;
+	pxRunningThread = pxTo;
+	sem_post( &( pxTo->xResume ) );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Entry point of every task thread.
+ */
+static void *prvTaskThread( void *pvParameters )
+{
+xThreadControl *pxThread = ( xThreadControl * ) pvParameters;
+
+	prvWaitToRun( pxThread );
+	pxThread->pxCode( pxThread->pvParameters );
+
+	/* Tasks must never return. */
+	abort();
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Delivered to the running task thread when an interrupt needs servicing:
+ * acknowledge that we've stopped and stay parked until we're chosen again.
+ */
+static void prvSuspendSignalHandler( int iSignal )
+{
+xThreadControl *pxThread = pxRunningThread;
+int iSavedErrno = errno;
+
+	( void ) iSignal;
+
+	pxThread->xRunning = pdFALSE;
+	sem_post( &xSuspendedSemaphore );
+	prvWaitToRun( pxThread );
+
+	errno = iSavedErrno;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Service any pending ticks and simulated interrupts, if interrupts are
+ * currently allowed.  Called from the interrupt thread with xPortMutex held.
+ */
+static void prvServiceInterrupts( void )
+{
+xThreadControl *pxInterrupted;
+unsigned portBASE_TYPE uxInterrupt;
+
+	if( ( uxPendingTicks == 0 ) && ( uxNumPendingInterrupts == 0 ) )
+	{
+		return;
+	}
+
+	/* Interrupts stay pending while they're masked, or while a task is part
+	way through being switched in. */
+	pxInterrupted = pxRunningThread;
+	if( ( pxInterrupted == NULL ) || ( pxInterrupted->xRunning == pdFALSE ) ||
+		( uxCriticalNesting != 0 ) || ( xInterruptsDisabled != pdFALSE ) )
+	{
+		return;
+	}
+
+	/* Stop the running task, just as taking an interrupt would. */
+	pthread_kill( pxInterrupted->xThread, portSUSPEND_SIGNAL );
+	while( sem_wait( &xSuspendedSemaphore ) != 0 )
+	{
+	}
+
+	while( uxPendingTicks > 0 )
+	{
+		uxPendingTicks--;
+		if( xTaskIncrementTick() != pdFALSE )
+		{
+			xYieldFromISRPending = pdTRUE;
+		}
+	}
+
+	/* A handler may raise another interrupt, so don't cache the count. */
+	for( uxInterrupt = 0; uxInterrupt < uxNumPendingInterrupts; uxInterrupt++ )
+	{
+		pxPendingInterrupts[ uxInterrupt ]();
+	}
+	uxNumPendingInterrupts = 0;
+
+	if( xYieldFromISRPending != pdFALSE )
+	{
+		xYieldFromISRPending = pdFALSE;
+		vTaskSwitchContext();
+	}
+
+	prvSwitchThreads( pxInterrupted, prvThreadFromTCB( pxCurrentTCB ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddNanoseconds( struct timespec *pxTime, long lNanoseconds )
+{
+	pxTime->tv_nsec += lNanoseconds;
+	while( pxTime->tv_nsec >= portNANOSECONDS_PER_SECOND )
+	{
+		pxTime->tv_nsec -= portNANOSECONDS_PER_SECOND;
+		pxTime->tv_sec++;
+	}
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * The interrupt thread: generates the tick and runs simulated interrupts.
+ */
+static void *prvInterruptThread( void *pvParameters )
+{
+struct timespec xNextTick;
+
+	( void ) pvParameters;
+
+	xIsInterruptContext = pdTRUE;
+	clock_gettime( CLOCK_MONOTONIC, &xNextTick );
+	prvAddNanoseconds( &xNextTick, portTICK_PERIOD_NS );
+
+	pthread_mutex_lock( &xPortMutex );
+	for( ;; )
+	{
+		if( pthread_cond_timedwait( &xInterruptCondition, &xPortMutex, &xNextTick ) == ETIMEDOUT )
+		{
+			uxPendingTicks++;
+			prvAddNanoseconds( &xNextTick, portTICK_PERIOD_NS );
+		}
+
+		prvServiceInterrupts();
+	}
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * See header file for description.  The FreeRTOS stack is not used to run
+ * the task (the pthread has its own) so all we keep on it is a pointer to
+ * the thread.
+ */
+portSTACK_TYPE *pxPortInitialiseStack( portSTACK_TYPE *pxTopOfStack, pdTASK_CODE pxCode, void *pvParameters )
+{
+xThreadControl *pxThread;
+
+	pxThread = ( xThreadControl * ) malloc( sizeof( xThreadControl ) );
+	if( pxThread == NULL )
+	{
+		abort();
+	}
+
+	pxThread->pxCode = pxCode;
+	pxThread->pvParameters = pvParameters;
+	pxThread->xRunning = pdFALSE;
+	pxThread->uxCriticalNesting = 0;
+	sem_init( &( pxThread->xResume ), 0, 0 );
+
+	if( pthread_create( &( pxThread->xThread ), NULL, prvTaskThread, pxThread ) != 0 )
+	{
+		abort();
+	}
+
+	/* The kernel aligned pxTopOfStack but it may still be the last byte of
+	the stack, so step down a whole pointer before writing one. */
+	pxTopOfStack -= sizeof( xThreadControl * );
+	memcpy( pxTopOfStack, &pxThread, sizeof( pxThread ) );
+
+	return pxTopOfStack;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xPortStartScheduler( void )
+{
+struct sigaction xAction;
+sigset_t xSignals;
+pthread_condattr_t xConditionAttributes;
+pthread_t xInterruptThread;
+
+	memset( &xAction, 0, sizeof( xAction ) );
+	xAction.sa_handler = prvSuspendSignalHandler;
+	xAction.sa_flags = SA_RESTART;
+	sigemptyset( &xAction.sa_mask );
+	sigaction( portSUSPEND_SIGNAL, &xAction, NULL );
+
+	/* Only task threads are ever suspended; this thread, and the interrupt
+	thread that inherits its mask, must never take the signal. */
+	sigemptyset( &xSignals );
+	sigaddset( &xSignals, portSUSPEND_SIGNAL );
+	pthread_sigmask( SIG_BLOCK, &xSignals, NULL );
+
+	sem_init( &xSuspendedSemaphore, 0, 0 );
+	sem_init( &xEndSchedulerSemaphore, 0, 0 );
+	pthread_condattr_init( &xConditionAttributes );
+	pthread_condattr_setclock( &xConditionAttributes, CLOCK_MONOTONIC );
+	pthread_cond_init( &xInterruptCondition, &xConditionAttributes );
+
+	pthread_mutex_lock( &xPortMutex );
+	{
+		/* Start the first task with interrupts enabled. */
+		uxCriticalNesting = 0;
+		xInterruptsDisabled = pdFALSE;
+		pxRunningThread = prvThreadFromTCB( pxCurrentTCB );
+		sem_post( &( pxRunningThread->xResume ) );
+
+		if( pthread_create( &xInterruptThread, NULL, prvInterruptThread, NULL ) != 0 )
+		{
+			abort();
+		}
+	}
+	pthread_mutex_unlock( &xPortMutex );
+
+	/* Nothing more for this thread to do until the scheduler is stopped. */
+	while( sem_wait( &xEndSchedulerSemaphore ) != 0 )
+	{
+	}
+
+	return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEndScheduler( void )
+{
+	sem_post( &xEndSchedulerSemaphore );
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+xThreadControl *pxThisThread;
+xThreadControl *pxNextThread;
+
+	if( xIsInterruptContext != pdFALSE )
+	{
+		xYieldFromISRPending = pdTRUE;
+		return;
+	}
+
+	pthread_mutex_lock( &xPortMutex );
+	pxThisThread = pxRunningThread;
+	vTaskSwitchContext();
+	pxNextThread = prvThreadFromTCB( pxCurrentTCB );
+
+	if( pxNextThread != pxThisThread )
+	{
+		prvSwitchThreads( pxThisThread, pxNextThread );
+		pthread_mutex_unlock( &xPortMutex );
+		prvWaitToRun( pxThisThread );
+	}
+	else
+	{
+		pthread_mutex_unlock( &xPortMutex );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortYieldFromISR( void )
+{
+	if( xIsInterruptContext != pdFALSE )
+	{
+		/* Switch when the interrupt returns. */
+		xYieldFromISRPending = pdTRUE;
+	}
+	else
+	{
+		vPortYield();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterCritical( void )
+{
+	if( xIsInterruptContext == pdFALSE )
+	{
+		pthread_mutex_lock( &xPortMutex );
+		uxCriticalNesting++;
+		pthread_mutex_unlock( &xPortMutex );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( void )
+{
+	if( xIsInterruptContext == pdFALSE )
+	{
+		pthread_mutex_lock( &xPortMutex );
+		if( uxCriticalNesting > 0 )
+		{
+			uxCriticalNesting--;
+			if( uxCriticalNesting == 0 )
+			{
+				/* Anything that arrived meanwhile can now be taken. */
+				pthread_cond_signal( &xInterruptCondition );
+			}
+		}
+		pthread_mutex_unlock( &xPortMutex );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortDisableInterrupts( void )
+{
+	if( xIsInterruptContext == pdFALSE )
+	{
+		pthread_mutex_lock( &xPortMutex );
+		xInterruptsDisabled = pdTRUE;
+		pthread_mutex_unlock( &xPortMutex );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnableInterrupts( void )
+{
+	if( xIsInterruptContext == pdFALSE )
+	{
+		pthread_mutex_lock( &xPortMutex );
+		xInterruptsDisabled = pdFALSE;
+		pthread_cond_signal( &xInterruptCondition );
+		pthread_mutex_unlock( &xPortMutex );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortGenerateSimulatedInterrupt( pdINTERRUPT_HANDLER pxHandler )
+{
+	if( xIsInterruptContext != pdFALSE )
+	{
+		/* Raised from inside another handler: we already hold the mutex and
+		the handler loop will pick it up. */
+		if( uxNumPendingInterrupts < portMAX_PENDING_INTERRUPTS )
+		{
+			pxPendingInterrupts[ uxNumPendingInterrupts++ ] = pxHandler;
+		}
+	}
+	else
+	{
+		pthread_mutex_lock( &xPortMutex );
+		if( uxNumPendingInterrupts < portMAX_PENDING_INTERRUPTS )
+		{
+			pxPendingInterrupts[ uxNumPendingInterrupts++ ] = pxHandler;
+		}
+		pthread_cond_signal( &xInterruptCondition );
+		pthread_mutex_unlock( &xPortMutex );
+	}
+}
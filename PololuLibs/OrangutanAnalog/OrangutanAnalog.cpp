@@ -24,6 +24,7 @@
  */
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "OrangutanAnalog.h"
 
 #include "../OrangutanResources/include/OrangutanModel.h"
@@ -64,6 +65,26 @@ extern "C" unsigned int analog_conversion_result_millivolts()
 	return OrangutanAnalog::conversionResultMillivolts();
 }
 
+extern "C" void start_analog_background_sampling(unsigned char num_channels)
+{
+	OrangutanAnalog::startBackgroundSampling(num_channels);
+}
+
+extern "C" void stop_analog_background_sampling()
+{
+	OrangutanAnalog::stopBackgroundSampling();
+}
+
+extern "C" unsigned int analog_read_background_average(unsigned char channel)
+{
+	return OrangutanAnalog::readBackgroundAverage(channel);
+}
+
+extern "C" unsigned int analog_read_background_average_millivolts(unsigned char channel)
+{
+	return OrangutanAnalog::readBackgroundAverageMillivolts(channel);
+}
+
 extern "C" void set_millivolt_calibration(unsigned int calibration)
 {
 	OrangutanAnalog::setMillivoltCalibration(calibration);
@@ -155,6 +176,15 @@ static unsigned int adc_result_millivolts;
 
 static unsigned int millivolt_calibration = 5000;	// contains VCC in millivolts
 
+// Background sampling state: the number of channels being sampled (0 when
+// stopped), the channel now converting, the slot in the rings it will go in,
+// the rings themselves and the sum of each
+static volatile unsigned char background_num_channels = 0;
+static volatile unsigned char background_channel;
+static volatile unsigned char background_pos;
+static unsigned int background_samples[ANALOG_BACKGROUND_MAX_CHANNELS][ANALOG_BACKGROUND_SAMPLES];
+static volatile unsigned int background_sums[ANALOG_BACKGROUND_MAX_CHANNELS];
+
 
 // constructor
 OrangutanAnalog::OrangutanAnalog()
@@ -326,6 +356,89 @@ unsigned int OrangutanAnalog::readAverage(unsigned char channel,
 }
 
 
+// ADC conversion complete: keep the result and start on the next channel
+ISR(ADC_vect)
+{
+	unsigned char channel = background_channel;
+	unsigned int result = ADC;
+	unsigned int *sample = &background_samples[channel][background_pos];
+
+	background_sums[channel] += result - *sample;	// running sum of the ring
+	*sample = result;
+
+	channel++;
+	if (channel >= background_num_channels)	// all channels done, next slot
+	{
+		channel = 0;
+		background_pos = (background_pos + 1) & (ANALOG_BACKGROUND_SAMPLES - 1);
+	}
+	background_channel = channel;
+
+	if (background_num_channels)	// unless stopped meanwhile
+	{
+		// change the channel in one write, see startConversion()
+		ADMUX = (ADMUX & ~0x1F) | channel;
+		ADCSRA |= 1 << ADSC;	// start the next conversion
+	}
+}
+
+void OrangutanAnalog::startBackgroundSampling(unsigned char numChannels)
+{
+	unsigned char i, j;
+
+	stopBackgroundSampling();
+
+	if (numChannels > ANALOG_BACKGROUND_MAX_CHANNELS)
+		numChannels = ANALOG_BACKGROUND_MAX_CHANNELS;
+	for (i = 0; i < ANALOG_BACKGROUND_MAX_CHANNELS; i++)
+	{
+		for (j = 0; j < ANALOG_BACKGROUND_SAMPLES; j++)
+			background_samples[i][j] = 0;
+		background_sums[i] = 0;
+	}
+	background_channel = 0;
+	background_pos = 0;
+	background_num_channels = numChannels;
+
+	if (numChannels)
+	{
+		unsigned char tempADMUX = ADMUX;
+		tempADMUX |= 1 << 6;		// use AVCC as a reference
+		tempADMUX &= ~(1 << 7);
+		tempADMUX &= ~(1 << ADLAR);	// 10-bit mode
+		tempADMUX &= ~0x1F;			// channel 0
+		ADMUX = tempADMUX;
+
+		// ADC enabled, conversion started, ADC interrupt enabled, prescaler 128,
+		// all in one write: setting ADIE afterwards with a read-modify-write
+		// could clear a conversion-complete flag that was already up and so
+		// lose the interrupt that keeps sampling going.
+		ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADIE) | 0x07;
+	}
+}
+
+void OrangutanAnalog::stopBackgroundSampling()
+{
+	background_num_channels = 0;	// the interrupt won't start another conversion
+	ADCSRA &= ~(1 << ADIE);
+	while (isConverting());		// let any conversion in progress finish
+}
+
+// returns the average of the latest background readings of the specified channel
+unsigned int OrangutanAnalog::readBackgroundAverage(unsigned char channel)
+{
+	if (channel >= ANALOG_BACKGROUND_MAX_CHANNELS)
+		return 0;
+
+	unsigned char sreg = SREG;	// the sum is two bytes, don't let the interrupt
+	cli();						// change it half way through reading it
+	unsigned int sum = background_sums[channel];
+	SREG = sreg;
+
+	return (sum + (ANALOG_BACKGROUND_SAMPLES >> 1)) / ANALOG_BACKGROUND_SAMPLES;
+}
+
+
 // sets the value used to calibrate the conversion from ADC reading
 // to millivolts.  The argument calibration should equal VCC in millivolts,
 // which can be automatically measured using the function readVCCMillivolts():
@@ -55,6 +55,11 @@
 
 #endif
 
+// Background sampling: how many channels can be sampled and how many of the
+// latest readings of each are kept (a power of two)
+#define ANALOG_BACKGROUND_MAX_CHANNELS	8
+#define ANALOG_BACKGROUND_SAMPLES		8
+
 #ifdef __cplusplus
 
 class OrangutanAnalog
@@ -155,6 +160,26 @@ class OrangutanAnalog
 	// returns the result of the previous ADC conversion in millivolts.
 	static unsigned int conversionResultMillivolts();
 	
+	// the following methods keep the ADC converting in the background, with
+	// no polling: each conversion-complete interrupt stores the result and
+	// starts a conversion on the next of channels 0 to numChannels - 1, in
+	// 10-bit mode against AVCC.  The latest ANALOG_BACKGROUND_SAMPLES readings
+	// of each channel are kept in a ring with a running sum, so an average can
+	// be had at any time without waiting.  The rings fill within
+	// ANALOG_BACKGROUND_SAMPLES rounds of the channels (about 4 ms for six
+	// channels at 20 MHz); until then the averages read low.
+	// *** NOTE ***: while background sampling is running the ADC belongs to it,
+	//  so none of the other read or conversion methods may be used.
+	static void startBackgroundSampling(unsigned char numChannels);
+	static void stopBackgroundSampling();
+	// returns the average of the latest background readings of the specified
+	// channel, or 0 if it is not being sampled
+	static unsigned int readBackgroundAverage(unsigned char channel);
+	static inline unsigned int readBackgroundAverageMillivolts(unsigned char channel)
+	{
+		return toMillivolts(readBackgroundAverage(channel));
+	}
+
 	// sets the value used to calibrate the conversion from ADC reading
 	// to millivolts.  The argument calibration should equal VCC in millivolts,
 	// which can be automatically measured using the function readVCCMillivolts():
@@ -249,6 +274,10 @@ static inline unsigned char analog_is_converting(void)
 }
 unsigned int analog_conversion_result(void);
 unsigned int analog_conversion_result_millivolts(void);
+void start_analog_background_sampling(unsigned char num_channels);
+void stop_analog_background_sampling(void);
+unsigned int analog_read_background_average(unsigned char channel);
+unsigned int analog_read_background_average_millivolts(unsigned char channel);
 void set_millivolt_calibration(unsigned int calibration);
 unsigned int read_vcc_millivolts(void);
 unsigned int to_millivolts(unsigned int analog_result);
@@ -57,6 +57,7 @@ const char *buzzerSequence = 0;
 // with globals in other .cpp files that share the same name
 static volatile unsigned int buzzerTimeout = 0;		// tracks buzzer time limit
 static char play_mode_setting = PLAY_AUTOMATIC;
+static BuzzerDoneCallback doneCallback = 0;
 
 extern volatile unsigned char buzzerFinished;	// flag: 0 while playing
 extern const char *buzzerSequence;
@@ -93,6 +94,11 @@ ISR (TIMER1_OVF_vect)
 		buzzerFinished = 1;
 		if (buzzerSequence && (play_mode_setting == PLAY_AUTOMATIC))
 			nextNote();
+		if (buzzerFinished && !buzzerSequence && doneCallback)
+		{
+			cli();		// the callback expects interrupts off, as in any ISR
+			doneCallback();
+		}
 	}
 }
 
@@ -136,6 +142,11 @@ extern "C" void stop_playing()
 	OrangutanBuzzer::stopPlaying();
 }
 
+extern "C" void buzzer_set_done_callback(BuzzerDoneCallback callback)
+{
+	OrangutanBuzzer::setDoneCallback(callback);
+}
+
 extern "C" void play_mode(unsigned char mode)
 {
 	OrangutanBuzzer::playMode(mode);
@@ -515,6 +526,17 @@ void OrangutanBuzzer::playFromProgramSpace(const char *notes_p)
 }
 
 
+// set the function to be called from the timer1 overflow interrupt when
+// playing finishes
+void OrangutanBuzzer::setDoneCallback(BuzzerDoneCallback callback)
+{
+	unsigned char timsk1 = TIMSK1;
+
+	DISABLE_TIMER1_INTERRUPT();	// the ISR mustn't see a half-written pointer
+	doneCallback = callback;
+	TIMSK1 = timsk1;
+}
+
 // stop all sound playback immediately
 void OrangutanBuzzer::stopPlaying()
 {
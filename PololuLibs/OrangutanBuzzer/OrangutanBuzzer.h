@@ -93,6 +93,11 @@
 
 #define DIV_BY_10		(1 << 15)		// frequency bit that indicates Hz/10
 
+// Type of the optional function that is told when the buzzer falls silent at
+// the end of a note or sequence started with play().  It is called from the
+// timer1 overflow interrupt, with interrupts disabled, so it must be quick.
+typedef void (*BuzzerDoneCallback)(void);
+
 
 #if defined(_ORANGUTAN_SVP) || defined(_ORANGUTAN_X2)
 
@@ -243,6 +248,10 @@ class OrangutanBuzzer
 	
 	// Stops all sound playback immediately.
 	static void stopPlaying();
+
+	// Sets a function to be called when playing finishes (in PLAY_AUTOMATIC
+	// mode), or 0 for none.  It is not called by stopPlaying().
+	static void setDoneCallback(BuzzerDoneCallback callback);
 	
 	
   private:
@@ -264,6 +273,7 @@ void play(const char *sequence);
 void play_from_program_space(const char *sequence);
 unsigned char is_playing(void);
 void stop_playing(void);
+void buzzer_set_done_callback(BuzzerDoneCallback callback);
 
 unsigned char play_check(void);
 void play_mode(unsigned char mode);
@@ -81,6 +81,16 @@ extern "C" void serial_cancel_receive(unsigned char port)
 	OrangutanSerial::cancelReceive(port);
 }
 
+extern "C" void serial_set_receive_callback(unsigned char port, SerialReceiveCallback callback)
+{
+	OrangutanSerial::setReceiveCallback(port, callback);
+}
+
+extern "C" void serial_set_send_callback(unsigned char port, SerialSendCallback callback)
+{
+	OrangutanSerial::setSendCallback(port, callback);
+}
+
 extern "C" unsigned char serial_get_received_bytes(unsigned char port)
 {
 	return OrangutanSerial::getReceivedBytes(port);
@@ -153,6 +163,16 @@ extern "C" void serial_cancel_receive()
 	OrangutanSerial::cancelReceive();
 }
 
+extern "C" void serial_set_receive_callback(SerialReceiveCallback callback)
+{
+	OrangutanSerial::setReceiveCallback(callback);
+}
+
+extern "C" void serial_set_send_callback(SerialSendCallback callback)
+{
+	OrangutanSerial::setSendCallback(callback);
+}
+
 extern "C" unsigned char serial_get_received_bytes()
 {
 	return OrangutanSerial::getReceivedBytes();
@@ -225,6 +245,16 @@ void OrangutanSerial::cancelReceive()
 	cancelReceive(0);
 }
 
+void OrangutanSerial::setReceiveCallback(SerialReceiveCallback callback)
+{
+	setReceiveCallback(0, callback);
+}
+
+void OrangutanSerial::setSendCallback(SerialSendCallback callback)
+{
+	setSendCallback(0, callback);
+}
+
 void OrangutanSerial::send(char *buffer, unsigned char size)
 {
 	send(0, buffer, size);
@@ -240,10 +270,10 @@ void OrangutanSerial::sendBlocking(char *message, unsigned char size)
 
 SerialPortData OrangutanSerial::ports[_SERIAL_PORTS] =
 {
-	{mode:SERIAL_AUTOMATIC, sentBytes:0, receivedBytes:0, sendSize:0, receiveSize:0, receiveRingOn:0, sendBuffer:0, receiveBuffer:0},
+	{mode:SERIAL_AUTOMATIC, sentBytes:0, receivedBytes:0, sendSize:0, receiveSize:0, receiveRingOn:0, sendBuffer:0, receiveBuffer:0, receiveCallback:0, sendCallback:0},
 #if _SERIAL_PORTS > 1
-	{mode:SERIAL_AUTOMATIC, sentBytes:0, receivedBytes:0, sendSize:0, receiveSize:0, receiveRingOn:0, sendBuffer:0, receiveBuffer:0},
-	{mode:SERIAL_CHECK,     sentBytes:0, receivedBytes:0, sendSize:0, receiveSize:0, receiveRingOn:0, sendBuffer:0, receiveBuffer:0},
+	{mode:SERIAL_AUTOMATIC, sentBytes:0, receivedBytes:0, sendSize:0, receiveSize:0, receiveRingOn:0, sendBuffer:0, receiveBuffer:0, receiveCallback:0, sendCallback:0},
+	{mode:SERIAL_CHECK,     sentBytes:0, receivedBytes:0, sendSize:0, receiveSize:0, receiveRingOn:0, sendBuffer:0, receiveBuffer:0, receiveCallback:0, sendCallback:0},
 #endif
 };
 
@@ -488,9 +518,16 @@ inline void OrangutanSerial::serial_rx_check(unsigned char port)
 			// We don't call serial_rx_handle_byte here, because that function resets receivedBytes
 			// during ring reception mode, which could cause an infinite loop here.
 
-			ports[USB_COMM].receiveBuffer[ports[USB_COMM].receivedBytes] = NEXT_BYTE;
+			unsigned char byte_received = NEXT_BYTE;
+
+			ports[USB_COMM].receiveBuffer[ports[USB_COMM].receivedBytes] = byte_received;
 			ports[USB_COMM].receivedBytes++; // the byte has been received
 
+			if(ports[USB_COMM].receiveCallback)
+			{
+				ports[USB_COMM].receiveCallback(USB_COMM, byte_received);
+			}
+
 			if(ports[USB_COMM].receivedBytes == ports[USB_COMM].receiveSize && ports[USB_COMM].receiveRingOn)
 			{
 				ports[USB_COMM].receivedBytes = 0; // reset the ring
@@ -519,6 +556,10 @@ inline void OrangutanSerial::serial_rx_handle_byte(unsigned char port, unsigned
 	{
 		ports[port].receivedBytes = 0; // reset the ring
 	}
+	if(ports[port].receiveCallback)
+	{
+		ports[port].receiveCallback(port, byte_received);
+	}
 }
 
 inline void OrangutanSerial::receive_inline(unsigned char port, char * buffer, unsigned char size, unsigned char receiveRingOn)
@@ -578,6 +619,42 @@ _SINGLE_PORT_INLINE void OrangutanSerial::cancelReceive(unsigned char port)
 	receive(port,0,0);
 }
 
+_SINGLE_PORT_INLINE void OrangutanSerial::setSendCallback(unsigned char port, SerialSendCallback callback)
+{
+	// Hold off the TX interrupt so that the ISR doesn't see a half-written pointer.
+	unsigned char udrie = 0;
+	if (_PORT_IS_UART)
+	{
+		udrie = *ucsrb(port) & (1<<UDRIE0);
+		*ucsrb(port) &= ~(1<<UDRIE0);
+	}
+
+	ports[port].sendCallback = callback;
+
+	if (_PORT_IS_UART)
+	{
+		*ucsrb(port) |= udrie;
+	}
+}
+
+_SINGLE_PORT_INLINE void OrangutanSerial::setReceiveCallback(unsigned char port, SerialReceiveCallback callback)
+{
+	// Hold off the RX interrupt so that the ISR doesn't see a half-written pointer.
+	unsigned char rxcie = 0;
+	if (_PORT_IS_UART)
+	{
+		rxcie = *ucsrb(port) & (1<<RXCIE);
+		*ucsrb(port) &= ~(1<<RXCIE);
+	}
+
+	ports[port].receiveCallback = callback;
+
+	if (_PORT_IS_UART)
+	{
+		*ucsrb(port) |= rxcie;
+	}
+}
+
 #ifdef USART_RX_vect
 ISR(USART_RX_vect)
 {
@@ -653,6 +730,11 @@ inline void OrangutanSerial::serial_tx_check(unsigned char port)
 				// We successfully started sending a byte
 				ports[USB_COMM].sentBytes++;
 
+				if (ports[USB_COMM].sentBytes == ports[USB_COMM].sendSize && ports[USB_COMM].sendCallback)
+				{
+					ports[USB_COMM].sendCallback(USB_COMM);
+				}
+
 				// Try to send another byte.
 				continue;
 			}
@@ -670,6 +752,11 @@ inline void OrangutanSerial::uart_tx_isr(unsigned char port)
 	{
 	    *udr(port) = ports[port].sendBuffer[ports[port].sentBytes];
 		ports[port].sentBytes++; // we started sending a byte
+
+		if (ports[port].sentBytes == ports[port].sendSize && ports[port].sendCallback)
+		{
+			ports[port].sendCallback(port);
+		}
 	}
 
 	// If called from an interrupt, this will disable the interrupt so we don't get called again.
@@ -62,6 +62,16 @@
 #define SERIAL_AUTOMATIC 0
 #define SERIAL_CHECK 1
 
+// Type of the optional function that is told about each byte as it is
+// received.  For a UART it is called from the RX interrupt, for USB_COMM
+// it is called from serial_check(), so it must be quick.
+typedef void (*SerialReceiveCallback)(unsigned char port, unsigned char byte_received);
+
+// Type of the optional function that is told when the last byte of a send
+// buffer has been started, i.e. when the buffer may be re-used.  For a UART
+// it is called from the UDRE interrupt, for USB_COMM from serial_check().
+typedef void (*SerialSendCallback)(unsigned char port);
+
 #ifdef __cplusplus
 
 typedef struct SerialPortData
@@ -74,6 +84,8 @@ typedef struct SerialPortData
 	unsigned char receiveRingOn; // boolean
 	char *sendBuffer;
 	char *receiveBuffer;
+	SerialReceiveCallback receiveCallback;
+	SerialSendCallback sendCallback;
 } SerialPortData;
 
 class OrangutanSerial
@@ -136,6 +148,12 @@ class OrangutanSerial
 
 	// sendBufferEmpty: True when the send buffer is empty.
 
+	// setReceiveCallback: Sets a function to be called with each byte
+	// after it has been stored in the receive buffer, or 0 for none.
+
+	// setSendCallback: Sets a function to be called when transmission of
+	// the last byte of the send buffer has started, or 0 for none.
+
 #if _SERIAL_PORTS == 1
 	static void setBaudRate(unsigned long baud);
 	static void setMode(unsigned char mode);
@@ -143,6 +161,8 @@ class OrangutanSerial
 	static char receiveBlocking(char *buffer, unsigned char size, unsigned int timeout_ms);
 	static void receiveRing(char *buffer, unsigned char size);
 	static void cancelReceive();
+	static void setReceiveCallback(SerialReceiveCallback callback);
+	static void setSendCallback(SerialSendCallback callback);
 	static void send(char *buffer, unsigned char size);
 	static void sendBlocking(char *buffer, unsigned char size);
 	static inline char sendBufferEmpty() { return ports[0].sentBytes == ports[0].sendSize; }
@@ -163,6 +183,8 @@ class OrangutanSerial
 	static _SINGLE_PORT_INLINE char receiveBlocking(unsigned char port, char *buffer, unsigned char size, unsigned int timeout_ms);
 	static _SINGLE_PORT_INLINE void receiveRing(unsigned char port, char *buffer, unsigned char size);
 	static _SINGLE_PORT_INLINE void cancelReceive(unsigned char port);
+	static _SINGLE_PORT_INLINE void setReceiveCallback(unsigned char port, SerialReceiveCallback callback);
+	static _SINGLE_PORT_INLINE void setSendCallback(unsigned char port, SerialSendCallback callback);
 	static _SINGLE_PORT_INLINE void send(unsigned char port, char *buffer, unsigned char size);
 	static _SINGLE_PORT_INLINE void sendBlocking(unsigned char port, char *buffer, unsigned char size);
 	static inline char sendBufferEmpty(unsigned char port) { return ports[port].sentBytes == ports[port].sendSize; }
@@ -204,6 +226,8 @@ void serial_set_mode(unsigned char port, unsigned char mode);
 unsigned char serial_get_mode(unsigned char port);
 void serial_receive(unsigned char port, char *buffer, unsigned char size);
 void serial_cancel_receive(unsigned char port);
+void serial_set_receive_callback(unsigned char port, SerialReceiveCallback callback);
+void serial_set_send_callback(unsigned char port, SerialSendCallback callback);
 char serial_receive_blocking(unsigned char port, char *buffer, unsigned char size, unsigned int timeout);
 void serial_receive_ring(unsigned char port, char *buffer, unsigned char size);
 unsigned char serial_get_received_bytes(unsigned char port);
@@ -218,6 +242,8 @@ void serial_set_mode(unsigned char mode);
 unsigned char serial_get_mode(void);
 void serial_receive(char *buffer, unsigned char size);
 void serial_cancel_receive(void);
+void serial_set_receive_callback(SerialReceiveCallback callback);
+void serial_set_send_callback(SerialSendCallback callback);
 char serial_receive_blocking(char *buffer, unsigned char size, unsigned int timeout);
 void serial_receive_ring(char *buffer, unsigned char size);
 unsigned char serial_get_received_bytes(void);
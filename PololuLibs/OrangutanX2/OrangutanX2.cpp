@@ -77,6 +77,12 @@ extern "C" void x2_set_motor(unsigned char motor, unsigned char operation_mode,
 	OrangutanX2::setMotor(motor, operation_mode, speed);
 }
 
+extern "C" void x2_set_motors(unsigned char m1_operation_mode, int m1_speed,
+	unsigned char m2_operation_mode, int m2_speed)
+{
+	OrangutanX2::setMotors(m1_operation_mode, m1_speed, m2_operation_mode, m2_speed);
+}
+
 extern "C" void x2_set_pwm_frequencies(unsigned char m1_resolution, unsigned char m1_prescaler,
 	unsigned char m2_resolution, unsigned char m2_prescaler, unsigned char save)
 {
@@ -281,23 +287,18 @@ unsigned char OrangutanX2::isEEPROMBusy()
 //****************************************************************************
 
 
+// Whether the auxiliary MCU has been put into joint-motor mode, shared by
+// setMotor() and setMotors()
+static unsigned char inJointMotorMode = 0;
+
+// Works out the command byte (returned) and data byte that set a motor (or the
+// joint motor) to a speed.  This is a PRIVATE method.
 // motor: 0 for M1, 1 for M2, 0xFF for joint
 // operationMode: 0 for immediate drive, 1 for acceleration drive, 0xFF for brake low
 // speed: -255 to 255 (absolute value of speed used when braking, otherwise sign = direction)
-void OrangutanX2::setMotor(unsigned char motor, unsigned char operationMode, int speed)
+unsigned char OrangutanX2::motorCommand(unsigned char motor, unsigned char operationMode, int speed,
+	unsigned char &data)
 {
-	static unsigned char inJointMotorMode = 0;
-
-	if (motor == JOINT_MOTOR && !inJointMotorMode)
-	{
-		OrangutanSPIMaster::transmit(CMD_ENABLE_JOINT_MOTOR_MODE);	// enable joint-motor mode
-		inJointMotorMode = 1;
-	}
-	if (motor != JOINT_MOTOR && inJointMotorMode)
-	{
-		OrangutanSPIMaster::transmit(CMD_DISABLE_JOINT_MOTOR_MODE);	// disable joint-motor mode
-		inJointMotorMode = 0;
-	}
 	unsigned char cmd;
 
 	if (motor == JOINT_MOTOR)					// if joint motor command
@@ -330,10 +331,52 @@ void OrangutanX2::setMotor(unsigned char motor, unsigned char operationMode, int
 	if (speed > 255)
 		speed = 255;
 	
-	// set LSB of command byte if speed has MSB set (MSB of speed is sent as LSB of cmd)
-	OrangutanSPIMaster::transmit(((unsigned char)speed) & 0x80 ? cmd | 1 : cmd);
 	// data byte is 7 low bits of speed
-	OrangutanSPIMaster::transmit(((unsigned char)speed) & 0x7F);
+	data = ((unsigned char)speed) & 0x7F;
+	// set LSB of command byte if speed has MSB set (MSB of speed is sent as LSB of cmd)
+	return ((unsigned char)speed) & 0x80 ? cmd | 1 : cmd;
+}
+
+void OrangutanX2::setMotor(unsigned char motor, unsigned char operationMode, int speed)
+{
+	if (motor == JOINT_MOTOR && !inJointMotorMode)
+	{
+		OrangutanSPIMaster::transmit(CMD_ENABLE_JOINT_MOTOR_MODE);	// enable joint-motor mode
+		inJointMotorMode = 1;
+	}
+	if (motor != JOINT_MOTOR && inJointMotorMode)
+	{
+		OrangutanSPIMaster::transmit(CMD_DISABLE_JOINT_MOTOR_MODE);	// disable joint-motor mode
+		inJointMotorMode = 0;
+	}
+	unsigned char data;
+	unsigned char cmd = motorCommand(motor, operationMode, speed, data);
+
+	OrangutanSPIMaster::transmit(cmd);
+	OrangutanSPIMaster::transmit(data);
+}
+
+
+// Sets both motors with the four bytes sent back to back, all worked out
+// beforehand, so that motor 2 follows motor 1 by only the time it takes to
+// send two bytes over SPI (about 7 us at 2.5 MHz) rather than by however long
+// the caller takes between two calls to setMotor().
+void OrangutanX2::setMotors(unsigned char M1OperationMode, int M1Speed,
+	unsigned char M2OperationMode, int M2Speed)
+{
+	unsigned char m1Data, m2Data;
+	unsigned char m1Cmd = motorCommand(MOTOR1, M1OperationMode, M1Speed, m1Data);
+	unsigned char m2Cmd = motorCommand(MOTOR2, M2OperationMode, M2Speed, m2Data);
+
+	if (inJointMotorMode)
+	{
+		OrangutanSPIMaster::transmit(CMD_DISABLE_JOINT_MOTOR_MODE);	// disable joint-motor mode
+		inJointMotorMode = 0;
+	}
+	OrangutanSPIMaster::transmit(m1Cmd);
+	OrangutanSPIMaster::transmit(m1Data);
+	OrangutanSPIMaster::transmit(m2Cmd);
+	OrangutanSPIMaster::transmit(m2Data);
 }
 
 
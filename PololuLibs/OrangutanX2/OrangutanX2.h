@@ -224,6 +224,8 @@ class OrangutanX2
   private:
 	static void writeToEEPROM(unsigned int address, unsigned char data);
 	static unsigned char isEEPROMBusy();
+	static unsigned char motorCommand(unsigned char motor, unsigned char operationMode, int speed,
+		unsigned char &data);
 
 	// Delays execution until the EEPROM on the auxiliary MCU is available for
 	// writing or reading.  This is a PRIVATE method.
@@ -277,6 +279,8 @@ class OrangutanX2
 	}
 	
 	static void setMotor(unsigned char motor, unsigned char operationMode, int speed);
+	static void setMotors(unsigned char M1OperationMode, int M1Speed,
+		unsigned char M2OperationMode, int M2Speed);
 	static void setPWMFrequencies(unsigned char M1Resolution, unsigned char M1Prescaler,
 		unsigned char M2Resolution, unsigned char M2Prescaler, unsigned char save);
 	static void setAcceleration(unsigned char motor, unsigned char accel,
@@ -321,6 +325,8 @@ unsigned char x2_read_eeprom_byte(unsigned int address);
 unsigned char x2_read_parameter(unsigned int param_address);
 
 void x2_set_motor(unsigned char motor, unsigned char operation_mode, int speed);
+void x2_set_motors(unsigned char m1_operation_mode, int m1_speed,
+	unsigned char m2_operation_mode, int m2_speed);
 void x2_set_pwm_frequencies(unsigned char m1_resolution, unsigned char m1_prescaler,
 	unsigned char m2_resolution, unsigned char m2_prescaler, unsigned char save);
 void x2_set_acceleration(unsigned char motor, unsigned char accel, unsigned char save);
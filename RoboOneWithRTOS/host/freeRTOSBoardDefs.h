@@ -0,0 +1,33 @@
+/* freeRTOSBoardDefs.h - Linux host build
+ *
+ * Stands in for FreeRTOSLib/include/freeRTOSBoardDefs.h when RoboOne is built
+ * on a workstation against the POSIX port.  Timings match the Orangutan X2 so
+ * that tick-based delays in the application mean the same thing.
+ */
+
+#ifndef freeRTOSBoardDefs_h
+#define freeRTOSBoardDefs_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+    #define F_CPU 20000000L
+
+    #define configTICK_RATE_HZ		( ( portTickType ) 1000 )
+	#define configCPU_CLOCK_HZ		( ( uint32_t ) F_CPU )
+    #define configTOTAL_HEAP_SIZE	( (size_t )  16000  )	/* The X2's 12000 plus room for the kernel's pointer-heavy structures */
+
+/* Pointers are wider than on the AVR */
+#define portPOINTER_SIZE_TYPE		uintptr_t
+
+/* The idle task sleeps in the hook rather than spinning a host CPU */
+#define configUSE_IDLE_HOOK			1
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // freeRTOSBoardDefs_h
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""Generate sharp_data.c and sharp_data.h, the distance table for the Sharp
+GP2Y0A41SK0F sensors.
+
+The sensor's output voltage against distance is the typical curve from the
+data sheet (white paper, 90% reflectance), read off at the points in CURVE.
+Between those points the reference curve is taken as straight in 1/distance,
+which is how the sensor behaves.  Beyond 40 cm there is nothing the sensor can
+see; nearer than 3.5 cm its output falls again and so can't be told from
+further away, which the robot will just have to treat as 3.5 cm.
+
+The table is indexed by the raw 10-bit ADC code, with AVCC (the X2's regulated
+5 V) as the reference, so reading a sensor needs no conversion to millivolts:
+an entry every 1 << STEP_SHIFT codes from the code at 40 cm, with the codes in
+between interpolated by adcToDistanceMm() in rob_distance.c.
+
+With --check the script instead reads "code mm" lines, as the host build's
+test_sharp_data prints them from running that very function, and fails unless
+there is one for every code from 0 to 1023, each 0 below the 40 cm code, 35 mm
+from the 3.5 cm code up and in between within TOLERANCE_PERCENT (or
+TOLERANCE_MM, whichever is more) of the reference curve.  The host build runs
+it every time, so change the curve, the step or the lookup and it will say if
+the distances are no longer good enough.
+
+Only the Python standard library is needed:
+
+    python3 gen_sharp_data.py [output directory]
+    ./build/test_sharp_data | python3 gen_sharp_data.py --check
+"""
+
+import math
+import os
+import sys
+
+# (distance in mm, typical output in volts) from the data sheet, furthest first
+CURVE = [
+    (400, 0.38),
+    (350, 0.42),
+    (300, 0.48),
+    (250, 0.56),
+    (200, 0.69),
+    (180, 0.76),
+    (160, 0.84),
+    (140, 0.95),
+    (120, 1.09),
+    (100, 1.29),
+    (90, 1.42),
+    (80, 1.57),
+    (70, 1.76),
+    (60, 2.00),
+    (50, 2.32),
+    (40, 2.74),
+    (35, 3.00),
+]
+
+REFERENCE_MILLIVOLTS = 5000
+ADC_MAX_CODE = 1023
+STEP_SHIFT = 3
+TOLERANCE_PERCENT = 1.0
+TOLERANCE_MM = 1  # Close in, where the table's whole mm are more than TOLERANCE_PERCENT
+
+
+def volts_to_code(volts):
+    return volts * ADC_MAX_CODE * 1000.0 / REFERENCE_MILLIVOLTS
+
+
+def reference_mm(code):
+    """The data sheet's distance for an ADC code, straight in 1/distance between
+    the points of CURVE and carried on from the end segments beyond them"""
+    for index in range(len(CURVE) - 1):
+        if code < volts_to_code(CURVE[index + 1][1]) or index == len(CURVE) - 2:
+            break
+    far_mm, far_volts = CURVE[index]
+    near_mm, near_volts = CURVE[index + 1]
+    far_code = volts_to_code(far_volts)
+    near_code = volts_to_code(near_volts)
+    inverse = 1.0 / far_mm + (code - far_code) * (1.0 / near_mm - 1.0 / far_mm) / (near_code - far_code)
+    return 1.0 / inverse
+
+
+def make_table():
+    """Return the first code, the last code and the table of distances in mm"""
+    first_code = int(math.ceil(volts_to_code(CURVE[0][1])))
+    last_code = int(math.ceil(volts_to_code(CURVE[-1][1])))
+    size = ((last_code - 1 - first_code) >> STEP_SHIFT) + 2
+    table = [int(round(reference_mm(first_code + (index << STEP_SHIFT)))) for index in range(size)]
+    return first_code, last_code, table
+
+
+def check(first_code, last_code, lines):
+    """Check the distances that the firmware's lookup gave, as "code mm" lines,
+    for every ADC code.  Return a list of what is wrong, empty if nothing, and
+    the worst error in range as (code, mm, reference mm, error as a fraction of
+    what is allowed)"""
+    looked_up = {}
+    for line in lines:
+        code, mm = (int(x) for x in line.split())
+        looked_up[code] = mm
+    wrong = []
+    worst = None
+    for code in range(ADC_MAX_CODE + 1):
+        if code not in looked_up:
+            wrong.append("code %d: no distance" % code)
+            continue
+        mm = looked_up[code]
+        if code < first_code:
+            if mm != 0:
+                wrong.append("code %d: %d mm where nothing is in range" % (code, mm))
+        elif code >= last_code:
+            if mm != CURVE[-1][0]:
+                wrong.append("code %d: %d mm where it should be %d" % (code, mm, CURVE[-1][0]))
+        else:
+            reference = reference_mm(code)
+            allowed = max(reference * TOLERANCE_PERCENT / 100.0, TOLERANCE_MM)
+            fraction = abs(mm - reference) / allowed
+            if fraction > 1:
+                wrong.append("code %d: %d mm against %.1f mm" % (code, mm, reference))
+            if worst is None or fraction > worst[3]:
+                worst = (code, mm, reference, fraction)
+    return wrong, worst
+
+
+def write(directory, first_code, last_code, table):
+    banner = ("/* Sharp data - distance table for the GP2Y0A41SK0F sensors of an application for the Pololu Orangutan X2\r\n"
+              " *\r\n"
+              " * GENERATED by host/gen_sharp_data.py from the data sheet's curve, don't edit:\r\n"
+              " * change the script and run it again.\r\n"
+              " */\r\n")
+
+    with open(os.path.join(directory, "sharp_data.h"), "w", newline="") as header:
+        header.write(banner)
+        header.write("\r\n#define SHARP_DATA_FIRST_CODE %d /* The ADC code at %d mm; below it there is nothing there */\r\n" % (first_code, CURVE[0][0]))
+        header.write("#define SHARP_DATA_LAST_CODE %d  /* The ADC code at %d mm; at and above it, read as that */\r\n" % (last_code, CURVE[-1][0]))
+        header.write("#define SHARP_DATA_MIN_MM %d\r\n" % CURVE[-1][0])
+        header.write("#define SHARP_DATA_STEP_SHIFT %d  /* An entry every 1 << this ADC codes */\r\n" % STEP_SHIFT)
+        header.write("#define SHARP_DATA_SIZE %d\r\n" % len(table))
+        header.write("\r\nextern const unsigned int gSharpDataMm[SHARP_DATA_SIZE];")
+
+    with open(os.path.join(directory, "sharp_data.c"), "w", newline="") as data:
+        data.write(banner)
+        data.write("\r\n#include <rob_system.h>\r\n#include <sharp_data.h>\r\n")
+        data.write("\r\n/* The distance in mm at ADC code SHARP_DATA_FIRST_CODE + (index << SHARP_DATA_STEP_SHIFT) */\r\n")
+        data.write("const unsigned int gSharpDataMm[SHARP_DATA_SIZE] PROGMEM =\r\n{\r\n")
+        for start in range(0, len(table), 8):
+            row = table[start:start + 8]
+            data.write("    %s%s /* %d */\r\n" % (", ".join("%3d" % x for x in row),
+                                                   "," if start + 8 < len(table) else " ",
+                                                   first_code + (start << STEP_SHIFT)))
+        data.write("};\r\n")
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    first_code, last_code, table = make_table()
+    if len(sys.argv) > 1 and sys.argv[1] == "--check":
+        wrong, worst = check(first_code, last_code, sys.stdin)
+        for line in wrong:
+            print(line)
+        if worst is not None:
+            code, mm, reference, fraction = worst
+            print("ADC codes %d to %d, worst at code %d: %d mm against %.1f mm (%d%% of the tolerance)" %
+                  (first_code, last_code, code, mm, reference, int(round(fraction * 100))))
+        if wrong:
+            sys.exit("%d of the codes wrong (allowed %.1f%% or %d mm in range), check the lookup or make STEP_SHIFT smaller" %
+                     (len(wrong), TOLERANCE_PERCENT, TOLERANCE_MM))
+        return
+    directory = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "..")
+    write(directory, first_code, last_code, table)
+    print("%d entries for ADC codes %d to %d" % (len(table), first_code, last_code))
+
+
+if __name__ == "__main__":
+    main()
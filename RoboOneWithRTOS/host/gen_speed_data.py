@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Generate speed_data.c and speed_data.h from "Robot Speed Data.xlsx".
+
+The spreadsheet's "Data Set 2" sheet holds the measurements: for each speed
+(column B, O units) and each distance the robot was asked to go (the block
+headed "10 cm" ... "4 Metres", the commanded distance in cm beside the
+heading), how far it actually went.  The factor for a cell is commanded over
+actual distance, i.e. how much harder (above 100) or softer (below 100) than
+nominal the motors have to be driven, in hundredths.  The "Damper" blocks and
+the polynomial fits are the spreadsheet's own extrapolations, not
+measurements, so they are left out.
+
+Factors are clamped to FACTOR_MIN..FACTOR_MAX so that a run where the robot
+barely moved (which says more about the motors' dead time than their speed)
+can't ask for a drive that wild, and so that they fit a byte.
+
+Only the Python standard library is needed:
+
+    python3 gen_speed_data.py ["../Robot Speed Data.xlsx" [output directory]]
+"""
+
+import os
+import re
+import sys
+import zipfile
+import xml.etree.ElementTree as ET
+
+FACTOR_MIN = 50
+FACTOR_MAX = 255
+SHEET_NAME = "Data Set 2"
+HEADING_ROW = 2
+FIRST_DATA_ROW = 3
+
+NS = {"m": "http://schemas.openxmlformats.org/spreadsheetml/2006/main"}
+REL_NS = "http://schemas.openxmlformats.org/officeDocument/2006/relationships"
+
+
+def column_number(letters):
+    number = 0
+    for letter in letters:
+        number = number * 26 + ord(letter) - ord("A") + 1
+    return number
+
+
+def column_letters(number):
+    letters = ""
+    while number:
+        number, remainder = divmod(number - 1, 26)
+        letters = chr(ord("A") + remainder) + letters
+    return letters
+
+
+def read_sheet(path, name):
+    """Return {cell reference: value} for a sheet, values as last saved by Excel"""
+    book = zipfile.ZipFile(path)
+    strings = []
+    if "xl/sharedStrings.xml" in book.namelist():
+        for item in ET.fromstring(book.read("xl/sharedStrings.xml")).findall("m:si", NS):
+            strings.append("".join(t.text or "" for t in item.iter("{%s}t" % NS["m"])))
+    workbook = ET.fromstring(book.read("xl/workbook.xml"))
+    relations = ET.fromstring(book.read("xl/_rels/workbook.xml.rels"))
+    targets = {relation.get("Id"): relation.get("Target") for relation in relations}
+    for sheet in workbook.find("m:sheets", NS):
+        if sheet.get("name") == name:
+            xml = ET.fromstring(book.read("xl/" + targets[sheet.get("{%s}id" % REL_NS)]))
+            cells = {}
+            for cell in xml.iter("{%s}c" % NS["m"]):
+                value = cell.find("m:v", NS)
+                if value is not None and value.text is not None:
+                    text = value.text
+                    if cell.get("t") == "s":
+                        text = strings[int(text)]
+                    cells[cell.get("r")] = text
+            return cells
+    sys.exit("No sheet called \"%s\" in %s" % (name, path))
+
+
+def number(text):
+    try:
+        return float(text)
+    except (TypeError, ValueError):
+        return None
+
+
+def measurements(cells):
+    """Return the speeds, the distances and the factor table, speeds by distances"""
+    speeds = []
+    row = FIRST_DATA_ROW
+    while number(cells.get("B%d" % row)) is not None:
+        speeds.append(int(number(cells["B%d" % row])))
+        row += 1
+
+    # A measured block is headed "<n> cm" or "<n> Metre(s)" with the commanded
+    # distance in the column beside it, which holds the actual distances below
+    blocks = []
+    for reference, text in cells.items():
+        match = re.match(r"([A-Z]+)%d$" % HEADING_ROW, reference)
+        if match and re.match(r"^\s*[\d.]+\s*(cm|metres?)\s*$", text, re.IGNORECASE):
+            column = column_letters(column_number(match.group(1)) + 1)
+            blocks.append((int(number(cells["%s%d" % (column, HEADING_ROW)])), column))
+    blocks.sort()
+
+    factors = []
+    for index in range(len(speeds)):
+        row = FIRST_DATA_ROW + index
+        factors.append([])
+        for distance, column in blocks:
+            actual = number(cells.get("%s%d" % (column, row)))
+            factor = FACTOR_MAX if not actual else int(round(100.0 * distance / actual))
+            factors[-1].append(min(max(factor, FACTOR_MIN), FACTOR_MAX))
+
+    return speeds, [distance for distance, column in blocks], factors
+
+
+def write(directory, source, speeds, distances, factors):
+    banner = ("/* Speed data - measured speed correction factors for an application for the Pololu Orangutan X2\r\n"
+              " *\r\n"
+              " * GENERATED by host/gen_speed_data.py from \"%s\", don't edit:\r\n"
+              " * change the spreadsheet and run the script again.\r\n"
+              " */\r\n" % os.path.basename(source))
+
+    with open(os.path.join(directory, "speed_data.h"), "w", newline="") as header:
+        header.write(banner)
+        header.write("\r\n#define SPEED_DATA_NUM_SPEEDS %d\r\n" % len(speeds))
+        header.write("#define SPEED_DATA_NUM_DISTANCES %d\r\n" % len(distances))
+        header.write("\r\nextern const unsigned int gSpeedDataSpeeds[SPEED_DATA_NUM_SPEEDS];\r\n")
+        header.write("extern const unsigned int gSpeedDataDistances[SPEED_DATA_NUM_DISTANCES];\r\n")
+        header.write("extern const unsigned char gSpeedDataFactors[SPEED_DATA_NUM_SPEEDS][SPEED_DATA_NUM_DISTANCES];")
+
+    with open(os.path.join(directory, "speed_data.c"), "w", newline="") as table:
+        table.write(banner)
+        table.write("\r\n#include <rob_system.h>\r\n#include <speed_data.h>\r\n")
+        table.write("\r\n/* The speeds, in O units, that the factors were measured at */\r\n")
+        table.write("const unsigned int gSpeedDataSpeeds[SPEED_DATA_NUM_SPEEDS] PROGMEM = {%s};\r\n" % ", ".join(str(x) for x in speeds))
+        table.write("\r\n/* The distances, in cm, that the factors were measured over */\r\n")
+        table.write("const unsigned int gSpeedDataDistances[SPEED_DATA_NUM_DISTANCES] PROGMEM = {%s};\r\n" % ", ".join(str(x) for x in distances))
+        table.write("\r\n/* Commanded over actual distance, in hundredths (%d to %d), by speed then distance */\r\n" % (FACTOR_MIN, FACTOR_MAX))
+        table.write("const unsigned char gSpeedDataFactors[SPEED_DATA_NUM_SPEEDS][SPEED_DATA_NUM_DISTANCES] PROGMEM =\r\n{\r\n")
+        for index, row in enumerate(factors):
+            table.write("    {%s}%s /* %d */\r\n" % (", ".join("%3d" % x for x in row), "," if index < len(factors) - 1 else " ", speeds[index]))
+        table.write("};\r\n")
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    source = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "..", "Robot Speed Data.xlsx")
+    directory = sys.argv[2] if len(sys.argv) > 2 else os.path.join(here, "..")
+    speeds, distances, factors = measurements(read_sheet(source, SHEET_NAME))
+    if not speeds or not distances:
+        sys.exit("No measurements found in %s" % source)
+    write(directory, source, speeds, distances, factors)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,98 @@
+/* Simulated Pololu library header - Linux host build
+ *
+ * Declares the subset of the Pololu AVR C library that RoboOne uses, with the
+ * same names, signatures and constants as the real thing, so that the
+ * application sources build unchanged.  The implementation is in
+ * rob_sim_hal.c.
+ */
+
+#ifndef OrangutanHost_h
+#define OrangutanHost_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* OrangutanDigital */
+#ifndef IO_D0
+#define IO_D0				0
+#define IO_D1				1
+#define IO_D2				2
+#define IO_D3				3
+#define IO_D4				4
+#define IO_D5				5
+#define IO_D6				6
+#define IO_D7				7
+#define IO_B2				10
+#endif
+
+#define HIGH_IMPEDANCE		0
+#define PULL_UP_ENABLED		1
+#define LOW					0
+#define HIGH				1
+
+void set_digital_output (unsigned char pin, unsigned char outputState);
+void set_digital_input (unsigned char pin, unsigned char inputState);
+unsigned char is_digital_input_high (unsigned char pin);
+
+/* OrangutanAnalog */
+void start_analog_background_sampling (unsigned char num_channels);
+unsigned int analog_read_background_average (unsigned char channel);
+
+/* OrangutanLCD */
+void lcd_init_printf (void);
+void clear (void);
+void lcd_goto_xy (unsigned char col, unsigned char row);
+void print_character (char c);
+
+/* OrangutanBuzzer */
+void play (const char * notes);
+void play_from_program_space (const char * notes);
+unsigned char is_playing (void);
+void stop_playing (void);
+
+/* OrangutanSerial */
+#define UART0				0
+#define UART1				1
+#define USB_COMM			2
+
+void serial_set_baud_rate (unsigned char port, unsigned long baud);
+void serial_receive_ring (unsigned char port, char * buffer, unsigned char size);
+unsigned char serial_get_received_bytes (unsigned char port);
+void serial_send (unsigned char port, char * buffer, unsigned char size);
+void serial_send_blocking (unsigned char port, char * buffer, unsigned char size);
+char serial_send_buffer_empty (unsigned char port);
+void serial_check (void);
+
+/* OrangutanX2 */
+#define MOTOR1				0
+#define MOTOR2				1
+#define JOINT_MOTOR			0xFF
+
+#define IMMEDIATE_DRIVE		0
+#define ACCEL_DRIVE			1
+#define BRAKE_LOW			0xFF
+
+#define UART_READ_BUFF_SZ	32
+#define UART_SEND_BUFF_SZ	32
+
+void x2_set_motor (unsigned char motor, unsigned char operation_mode, int speed);
+void x2_set_motors (unsigned char m1_operation_mode, int m1_speed, unsigned char m2_operation_mode, int m2_speed);
+unsigned char x2_get_motor_current (unsigned char motor);
+void x2_save_eeprom_byte (unsigned int address, unsigned char data);
+unsigned char x2_read_eeprom_byte (unsigned int address);
+
+/* PololuWheelEncoders */
+void encoders_init (unsigned char m1a, unsigned char m1b, unsigned char m2a, unsigned char m2b);
+int encoders_get_counts_m1 (void);
+int encoders_get_counts_m2 (void);
+int encoders_get_counts_and_reset_m1 (void);
+int encoders_get_counts_and_reset_m2 (void);
+unsigned char encoders_check_error_m1 (void);
+unsigned char encoders_check_error_m2 (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,27 @@
+/* Host stubs - part of an application for the Pololu Orangutan X2
+ *
+ * Replaces the avr-libc bits that rob_system.h pulls in so that the
+ * application can be built and run on a Linux host (see host/Makefile).
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+#ifndef ROB_HOSTSTUBS_H
+#define ROB_HOSTSTUBS_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* Program space is just ordinary memory on the host */
+#define PROGMEM
+#define PSTR(sTRING) (sTRING)
+#define pgm_read_byte(aDDRESS) (*(const unsigned char *) (aDDRESS))
+#define pgm_read_word(aDDRESS) (*(aDDRESS)) /* Words are whatever 16 bit type the table holds */
+
+/* avr-libc extensions that glibc doesn't have */
+char * itoa (int value, char * pString, int radix);
+char * utoa (unsigned int value, char * pString, int radix);
+char * ltoa (long value, char * pString, int radix);
+
+#endif
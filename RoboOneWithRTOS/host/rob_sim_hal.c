@@ -0,0 +1,1035 @@
+/* Simulated hardware - part of an application for the Pololu Orangutan X2
+ *
+ * Implements the parts of the Pololu library declared in host/pololu/orangutan.h
+ * on a Linux host so that RoboOne can run against the FreeRTOS POSIX port.
+ *
+ * - The USB_COMM serial port is stdin/stdout.  As on the X2, bytes arrive at the
+ *   auxiliary processor (a 32 byte FIFO filled from stdin at the baud rate) and
+ *   only reach the application's receive ring when serial_check() is called.
+ *   Transmitted bytes drain to stdout at the baud rate.
+ * - The LCD, buzzer and motors log to stderr if ROB_HOST_VERBOSE is set.  A tune
+ *   "plays" (is_playing() returns true) for as long as its notes would take.
+ * - ADC channels read 0 mV and digital inputs read high until told otherwise.
+ *   Lines on stdin beginning with '~' control the simulation rather than being
+ *   passed to the application:
+ *       ~a <channel> <millivolts>   set an ADC channel
+ *       ~s <channel> <millivolts>   spike an ADC channel: its next reading only reads this
+ *       ~d <pin> <0|1>              set a digital input
+ *       ~m <motor> <percent>        set how well motor 1 or 2 performs (default 100)
+ *       ~i <ms>                     set the wheels' time constant (default 0)
+ *       ~j <motor> <0|1>            jam motor 1 or 2's wheel, or free it
+ * - The wheel encoders count as the motors would turn them if a drive of so many O
+ *   units gave exactly the nominal speed (see rob_motion.h) times the motor's
+ *   percentage, so a flat battery or a weak motor is one '~m' line away.  The
+ *   wheels get to that speed (or, braked, to rest) instantly unless given some
+ *   inertia with '~i', in which case they close on it with that time constant.
+ *   A jammed wheel doesn't turn at all.
+ * - A motor draws a little current when driven plus more for however far its wheel
+ *   is behind the speed the drive would give, so most while starting off and,
+ *   stalled, in proportion to the drive.
+ * - The auxiliary processor's EEPROM starts blank (all 0xFF) unless ROB_HOST_EEPROM
+ *   names a file, in which case it is loaded from there and written back to it on
+ *   every write, so what is saved survives from one run to the next.  A write takes
+ *   as long as the real one and, as on the X2, won't touch the parameter bytes.
+ * - When stdin ends the process exits after ROB_HOST_LINGER_MS (default 2000)
+ *   so that piped command scripts can see their replies.
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+#include <pololu/orangutan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <rob_system.h>
+#include <rob_wrappers.h>
+#include <rob_motion.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#define LCD_NUM_COLS 16
+#define LCD_NUM_ROWS 4
+#define NUM_ADC_CHANNELS 8
+#define NUM_DIGITAL_PINS 24
+#define NUM_MOTORS 2
+
+#define LCD_CHARACTER_TIME_US 50      /* Roughly what the HD44780 takes to accept a character */
+#define SIM_CONTROL_CHARACTER '~'
+#define SIM_CONTROL_LINE_LEN 32
+#define DEFAULT_LINGER_MS 2000
+#define VCC_MILLIVOLTS 5000
+#define ADC_MAX_CODE 1023
+#define DEFAULT_TEMPO_BPM 120
+#define DEFAULT_NOTE_LENGTH 4
+#define CURRENT_NO_LOAD 0.8     /* In the X2's current units (about 150 mA), for a driven motor turning freely */
+#define CURRENT_PER_O_UNIT 0.04 /* Extra for each O unit of drive the wheel isn't turning at, 1.6 A stalled at full drive */
+#define CURRENT_MAX 255
+#define EEPROM_SIZE 512
+#define EEPROM_LAST_PARAMETER_ADDRESS 23 /* The X2's own settings live at and below this */
+#define EEPROM_WRITE_TIME_US 3400
+#define ENCODER_COUNTS_PER_O_UNIT_SECOND ((10.0 * WHEEL_COUNTS_PER_REV) / (CM_S_TO_O_UNITS_FACTOR * WHEEL_CIRCUMFERENCE_MM))
+
+/* - GLOBALS -------------------------------------------------------------------------- */
+
+static bool gVerbose = false;
+
+/* LCD */
+static char gLcd[LCD_NUM_ROWS][LCD_NUM_COLS];
+static unsigned char gLcdCol = 0;
+static unsigned char gLcdRow = 0;
+static bool gLcdChanged = false;
+
+/* ADC and digital I/O, written by the stdin reader thread */
+static volatile unsigned int gAdcMilliVolts[NUM_ADC_CHANNELS];
+static volatile unsigned char gAdcNumSampledChannels = 0;
+static volatile unsigned int gAdcSpikeMilliVolts[NUM_ADC_CHANNELS];
+static volatile bool gAdcSpiked[NUM_ADC_CHANNELS];
+static volatile unsigned char gDigitalInputLow[NUM_DIGITAL_PINS];
+
+/* Motors */
+static unsigned char gMotorMode[NUM_MOTORS];
+static int gMotorSpeed[NUM_MOTORS];
+static volatile unsigned int gMotorPercent[NUM_MOTORS] = {100, 100};
+static volatile unsigned int gWheelTimeConstantMs = 0;
+static volatile bool gWheelJammed[NUM_MOTORS];
+
+/* The auxiliary processor's EEPROM and the file, if any, that keeps it */
+static unsigned char gEeprom[EEPROM_SIZE];
+static bool gEepromLoaded = false;
+static const char * gpEepromFileName = PNULL;
+
+/* How fast the wheels are actually going, in O units */
+static double gWheelSpeed[NUM_MOTORS];
+
+/* Wheel encoders: counts, including part counts, since last read and reset */
+static double gEncoderCounts[NUM_MOTORS];
+static long long gEncoderTimeUs = 0;
+
+/* Buzzer */
+static volatile long long gTuneEndTimeUs = 0;
+static volatile bool gTuneDonePending = false;
+static BuzzerDoneCallback gpBuzzerDoneCallback = PNULL;
+static bool gBuzzerTimerStarted = false;
+
+/* USB_COMM, as seen from the auxiliary processor */
+static pthread_mutex_t gSerialMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gSerialCondition = PTHREAD_COND_INITIALIZER;
+static bool gReaderStarted = false;
+static unsigned long gBaudRate = 9600;
+static char gAuxReceiveFifo[UART_READ_BUFF_SZ];
+static unsigned char gAuxReceiveCount = 0;
+static unsigned char gAuxReceiveReadPos = 0;
+static unsigned char gAuxSendCount = 0;
+static struct timespec gAuxSendDrainTime;
+
+/* USB_COMM, as seen from the application */
+static char * gpReceiveRing = PNULL;
+static unsigned char gReceiveRingSize = 0;
+static unsigned char gReceiveRingPos = 0;
+static SerialReceiveCallback gpReceiveCallback = PNULL;
+static SerialSendCallback gpSendCallback = PNULL;
+static char * gpSendBuffer = PNULL;
+static unsigned char gSendSize = 0;
+static unsigned char gSendPos = 0;
+
+/* - STATIC FUNCTIONS ----------------------------------------------------------------- */
+
+static long long timeNowUs (void)
+{
+    struct timespec now;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+
+    return ((long long) now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
+/* Burn time the way the hardware would, pre-emptibly, as the real library does */
+static void busyWaitUs (unsigned long us)
+{
+    long long endTime = timeNowUs() + us;
+
+    while (timeNowUs() < endTime)
+    {
+    }
+}
+
+/* Roughly how long the OrangutanBuzzer note sequencer takes to play a tune, in ms;
+ * only note lengths, dots, rests, tempo (T) and default length (L) matter */
+static unsigned long tuneDurationMs (const char * pNotes)
+{
+    unsigned long durationMs = 0;
+    unsigned long noteMs;
+    unsigned long dotMs;
+    unsigned int tempo = DEFAULT_TEMPO_BPM;
+    unsigned int defaultLength = DEFAULT_NOTE_LENGTH;
+    unsigned int number;
+    bool isNote;
+    char c;
+
+    while (*pNotes != 0)
+    {
+        c = tolower (*pNotes);
+        pNotes++;
+        if (c == 'm') /* Staccato/legato, followed by another letter */
+        {
+            if (*pNotes != 0)
+            {
+                pNotes++;
+            }
+            continue;
+        }
+        isNote = (c >= 'a' && c <= 'g') || c == 'r';
+        while (isNote && (*pNotes == '+' || *pNotes == '#' || *pNotes == '-'))
+        {
+            pNotes++;
+        }
+        number = 0;
+        while (isdigit (*pNotes))
+        {
+            number = (number * 10) + (*pNotes - '0');
+            pNotes++;
+        }
+        if (isNote)
+        {
+            noteMs = 240000UL / ((unsigned long) tempo * (number > 0 ? number : defaultLength));
+            durationMs += noteMs;
+            for (dotMs = noteMs / 2; *pNotes == '.'; dotMs /= 2)
+            {
+                durationMs += dotMs;
+                pNotes++;
+            }
+        }
+        else if (c == 't' && number > 0)
+        {
+            tempo = number;
+        }
+        else if (c == 'l' && number > 0)
+        {
+            defaultLength = number;
+        }
+    }
+
+    return durationMs;
+}
+
+/* Simulated timer1 overflow interrupt at the end of a tune */
+static void buzzerInterrupt (void)
+{
+    if (gTuneDonePending && timeNowUs() >= gTuneEndTimeUs)
+    {
+        gTuneDonePending = false;
+        if (gpBuzzerDoneCallback != PNULL)
+        {
+            gpBuzzerDoneCallback();
+        }
+    }
+}
+
+/* Host thread standing in for timer1: raises the interrupt when a tune has ended */
+static void * buzzerTimer (void * pParameters)
+{
+    while (1)
+    {
+        usleep (1000);
+        if (gTuneDonePending && timeNowUs() >= gTuneEndTimeUs)
+        {
+            vPortGenerateSimulatedInterrupt (buzzerInterrupt);
+        }
+    }
+
+    return PNULL;
+}
+
+/* Turn the wheel encoders on by however far the motors have driven them since
+ * last time; call from within a critical section */
+static void encodersUpdate (void)
+{
+    long long now = timeNowUs();
+    double seconds;
+    double timeConstant;
+    double decay;
+    double speed;
+    unsigned char x;
+
+    if (gEncoderTimeUs != 0)
+    {
+        seconds = (now - gEncoderTimeUs) / 1000000.0;
+        timeConstant = gWheelTimeConstantMs / 1000.0;
+        for (x = 0; x < NUM_MOTORS; x++)
+        {
+            speed = gWheelJammed[x] ? 0 : gMotorSpeed[x] * (gMotorPercent[x] / 100.0);
+            if (timeConstant > 0 && !gWheelJammed[x])
+            {
+                /* The speed closes on the motor's exponentially: integrate that */
+                decay = exp (-seconds / timeConstant);
+                gEncoderCounts[x] += (speed * seconds + (gWheelSpeed[x] - speed) * timeConstant * (1 - decay)) * ENCODER_COUNTS_PER_O_UNIT_SECOND;
+                gWheelSpeed[x] = speed + (gWheelSpeed[x] - speed) * decay;
+            }
+            else
+            {
+                gEncoderCounts[x] += speed * seconds * ENCODER_COUNTS_PER_O_UNIT_SECOND;
+                gWheelSpeed[x] = speed;
+            }
+        }
+    }
+    gEncoderTimeUs = now;
+}
+
+/* Whole counts on a wheel encoder, optionally taking them away */
+static int encoderCounts (unsigned char motor, bool reset)
+{
+    int counts;
+
+    portENTER_CRITICAL();
+    {
+        encodersUpdate();
+        counts = (int) gEncoderCounts[motor];
+        if (reset)
+        {
+            gEncoderCounts[motor] -= counts;
+        }
+    }
+    portEXIT_CRITICAL();
+
+    return counts;
+}
+
+/* Time, in microseconds, to clock one byte out at the current baud rate */
+static unsigned long byteTimeUs (void)
+{
+    return 10000000UL / gBaudRate;
+}
+
+static void writeAll (int fd, const char * pBuffer, size_t size)
+{
+    ssize_t written;
+
+    while (size > 0)
+    {
+        written = write (fd, pBuffer, size);
+        if (written <= 0)
+        {
+            return;
+        }
+        pBuffer += written;
+        size -= written;
+    }
+}
+
+/* Log the display if it has changed since it was last logged */
+static void lcdShow (void)
+{
+    char lcd[LCD_NUM_ROWS][LCD_NUM_COLS];
+    unsigned char row;
+    char line[LCD_NUM_COLS + 8];
+    bool changed;
+
+    portENTER_CRITICAL();
+    {
+        changed = gLcdChanged;
+        gLcdChanged = false;
+        memcpy (lcd, gLcd, sizeof (lcd));
+    }
+    portEXIT_CRITICAL();
+
+    if (changed && gVerbose)
+    {
+        for (row = 0; row < LCD_NUM_ROWS; row++)
+        {
+            memcpy (line, "[LCD] |", 7);
+            memcpy (line + 7, lcd[row], LCD_NUM_COLS);
+            line[LCD_NUM_COLS + 7] = '\n';
+            writeAll (STDERR_FILENO, line, sizeof (line));
+        }
+    }
+}
+
+static void logString (const char * pPrefix, const char * pString)
+{
+    char line[128];
+    int len;
+
+    if (gVerbose)
+    {
+        len = snprintf (line, sizeof (line), "[%s] %s\n", pPrefix, pString);
+        if (len > (int) sizeof (line) - 1)
+        {
+            len = sizeof (line) - 1;
+        }
+        writeAll (STDERR_FILENO, line, len);
+    }
+}
+
+/* Act on a '~' line from stdin */
+static void simControl (const char * pLine)
+{
+    unsigned int index;
+    unsigned int value;
+
+    if (sscanf (pLine, "~a %u %u", &index, &value) == 2 && index < NUM_ADC_CHANNELS)
+    {
+        gAdcMilliVolts[index] = value;
+    }
+    else if (sscanf (pLine, "~s %u %u", &index, &value) == 2 && index < NUM_ADC_CHANNELS)
+    {
+        gAdcSpikeMilliVolts[index] = value;
+        gAdcSpiked[index] = true;
+    }
+    else if (sscanf (pLine, "~d %u %u", &index, &value) == 2 && index < NUM_DIGITAL_PINS)
+    {
+        gDigitalInputLow[index] = (value == 0);
+    }
+    else if (sscanf (pLine, "~m %u %u", &index, &value) == 2 && index >= 1 && index <= NUM_MOTORS)
+    {
+        gMotorPercent[index - 1] = value;
+    }
+    else if (sscanf (pLine, "~i %u", &value) == 1)
+    {
+        gWheelTimeConstantMs = value;
+    }
+    else if (sscanf (pLine, "~j %u %u", &index, &value) == 2 && index >= 1 && index <= NUM_MOTORS)
+    {
+        gWheelJammed[index - 1] = (value != 0);
+    }
+}
+
+/* Hand one received byte to the auxiliary processor, waiting for room */
+static void auxReceiveByte (char c)
+{
+    pthread_mutex_lock (&gSerialMutex);
+    while (gAuxReceiveCount >= sizeof (gAuxReceiveFifo))
+    {
+        pthread_cond_wait (&gSerialCondition, &gSerialMutex);
+    }
+    gAuxReceiveFifo[(gAuxReceiveReadPos + gAuxReceiveCount) % sizeof (gAuxReceiveFifo)] = c;
+    gAuxReceiveCount++;
+    pthread_mutex_unlock (&gSerialMutex);
+}
+
+/* Host thread standing in for the wire: stdin to the auxiliary processor */
+static void * stdinReader (void * pParameters)
+{
+    int c;
+    char controlLine[SIM_CONTROL_LINE_LEN];
+    unsigned char controlLen = 0;
+    bool inControlLine = false;
+    bool atLineStart = true;
+    const char * pLinger;
+
+    while ((c = getchar()) != EOF)
+    {
+        if (atLineStart && c == SIM_CONTROL_CHARACTER)
+        {
+            inControlLine = true;
+            controlLen = 0;
+        }
+        atLineStart = (c == '\n');
+
+        if (inControlLine)
+        {
+            if (c == '\n')
+            {
+                controlLine[controlLen] = 0;
+                simControl (controlLine);
+                inControlLine = false;
+            }
+            else if (controlLen < sizeof (controlLine) - 1)
+            {
+                controlLine[controlLen] = c;
+                controlLen++;
+            }
+        }
+        else
+        {
+            usleep (byteTimeUs());
+            auxReceiveByte (c);
+        }
+    }
+
+    pLinger = getenv ("ROB_HOST_LINGER_MS");
+    usleep ((pLinger != PNULL ? atoi (pLinger) : DEFAULT_LINGER_MS) * 1000UL);
+    exit (0);
+
+    return PNULL;
+}
+
+/* Move the auxiliary processor's send FIFO on by however long has passed */
+static void auxDrainSend (void)
+{
+    struct timespec now;
+    long long elapsedUs;
+    unsigned long drained;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    if (gAuxSendCount == 0)
+    {
+        gAuxSendDrainTime = now;
+    }
+    else
+    {
+        elapsedUs = ((long long) (now.tv_sec - gAuxSendDrainTime.tv_sec) * 1000000) + ((now.tv_nsec - gAuxSendDrainTime.tv_nsec) / 1000);
+        drained = elapsedUs / byteTimeUs();
+        if (drained > 0)
+        {
+            if (drained >= gAuxSendCount)
+            {
+                gAuxSendCount = 0;
+                gAuxSendDrainTime = now;
+            }
+            else
+            {
+                gAuxSendCount -= drained;
+                gAuxSendDrainTime.tv_nsec += drained * byteTimeUs() * 1000;
+                while (gAuxSendDrainTime.tv_nsec >= 1000000000L)
+                {
+                    gAuxSendDrainTime.tv_nsec -= 1000000000L;
+                    gAuxSendDrainTime.tv_sec++;
+                }
+            }
+        }
+    }
+}
+
+/* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* OrangutanDigital */
+
+void set_digital_output (unsigned char pin, unsigned char outputState)
+{
+}
+
+void set_digital_input (unsigned char pin, unsigned char inputState)
+{
+}
+
+unsigned char is_digital_input_high (unsigned char pin)
+{
+    return (pin < NUM_DIGITAL_PINS) && !gDigitalInputLow[pin];
+}
+
+/* OrangutanAnalog */
+
+/* The real thing converts in the background from the ADC interrupt; here the
+ * channels simply read as last set */
+void start_analog_background_sampling (unsigned char num_channels)
+{
+    gAdcNumSampledChannels = num_channels;
+}
+
+/* As a 10-bit code against a VCC_MILLIVOLTS reference */
+unsigned int analog_read_background_average (unsigned char channel)
+{
+    unsigned long millivolts = 0;
+
+    if (channel < gAdcNumSampledChannels && channel < NUM_ADC_CHANNELS)
+    {
+        millivolts = gAdcMilliVolts[channel];
+        if (gAdcSpiked[channel])
+        {
+            millivolts = gAdcSpikeMilliVolts[channel];
+            gAdcSpiked[channel] = false;
+        }
+    }
+    millivolts = (millivolts * ADC_MAX_CODE + VCC_MILLIVOLTS / 2) / VCC_MILLIVOLTS;
+
+    return millivolts > ADC_MAX_CODE ? ADC_MAX_CODE : millivolts;
+}
+
+/* OrangutanLCD */
+
+void lcd_init_printf (void)
+{
+}
+
+void clear (void)
+{
+    portENTER_CRITICAL();
+    {
+        memset (gLcd, ' ', sizeof (gLcd));
+        gLcdCol = 0;
+        gLcdRow = 0;
+        gLcdChanged = true;
+    }
+    portEXIT_CRITICAL();
+    busyWaitUs (LCD_CHARACTER_TIME_US * 40); /* Clear display is a slow instruction */
+}
+
+void lcd_goto_xy (unsigned char col, unsigned char row)
+{
+    portENTER_CRITICAL();
+    {
+        gLcdCol = col;
+        gLcdRow = row;
+    }
+    portEXIT_CRITICAL();
+    busyWaitUs (LCD_CHARACTER_TIME_US);
+}
+
+void print_character (char c)
+{
+    portENTER_CRITICAL();
+    {
+        if (gLcdCol < LCD_NUM_COLS && gLcdRow < LCD_NUM_ROWS)
+        {
+            gLcd[gLcdRow][gLcdCol] = c;
+            gLcdCol++;
+            gLcdChanged = true;
+        }
+    }
+    portEXIT_CRITICAL();
+    busyWaitUs (LCD_CHARACTER_TIME_US);
+}
+
+/* OrangutanBuzzer */
+
+void play (const char * notes)
+{
+    long long endTimeUs = timeNowUs() + ((long long) tuneDurationMs (notes) * 1000);
+
+    portENTER_CRITICAL();
+    {
+        gTuneEndTimeUs = endTimeUs;
+        gTuneDonePending = true;
+        logString ("BUZZER", notes);
+    }
+    portEXIT_CRITICAL();
+}
+
+void play_from_program_space (const char * notes)
+{
+    play (notes);
+}
+
+unsigned char is_playing (void)
+{
+    return timeNowUs() < gTuneEndTimeUs;
+}
+
+void stop_playing (void)
+{
+    portENTER_CRITICAL();
+    {
+        gTuneEndTimeUs = 0;
+        gTuneDonePending = false;
+    }
+    portEXIT_CRITICAL();
+}
+
+/* From libRobPololu's OrangutanBuzzer */
+void buzzer_set_done_callback (BuzzerDoneCallback callback)
+{
+    pthread_t timer;
+
+    portENTER_CRITICAL();
+    {
+        gpBuzzerDoneCallback = callback;
+    }
+    portEXIT_CRITICAL();
+
+    if (!gBuzzerTimerStarted)
+    {
+        gBuzzerTimerStarted = true;
+        pthread_create (&timer, NULL, buzzerTimer, PNULL);
+    }
+}
+
+/* OrangutanSerial, USB_COMM only */
+
+void serial_set_baud_rate (unsigned char port, unsigned long baud)
+{
+    if (port == USB_COMM && baud > 0)
+    {
+        gBaudRate = baud;
+    }
+}
+
+void serial_receive_ring (unsigned char port, char * buffer, unsigned char size)
+{
+    pthread_t reader;
+
+    if (port == USB_COMM)
+    {
+        portENTER_CRITICAL();
+        {
+            gpReceiveRing = buffer;
+            gReceiveRingSize = size;
+            gReceiveRingPos = 0;
+        }
+        portEXIT_CRITICAL();
+
+        if (!gReaderStarted)
+        {
+            gReaderStarted = true;
+            gVerbose = (getenv ("ROB_HOST_VERBOSE") != PNULL);
+            pthread_create (&reader, NULL, stdinReader, PNULL);
+        }
+    }
+}
+
+/* From libRobPololu's OrangutanSerial */
+void serial_set_receive_callback (unsigned char port, SerialReceiveCallback callback)
+{
+    if (port == USB_COMM)
+    {
+        gpReceiveCallback = callback;
+    }
+}
+
+void serial_set_send_callback (unsigned char port, SerialSendCallback callback)
+{
+    if (port == USB_COMM)
+    {
+        gpSendCallback = callback;
+    }
+}
+
+unsigned char serial_get_received_bytes (unsigned char port)
+{
+    return port == USB_COMM ? gReceiveRingPos : 0;
+}
+
+void serial_send (unsigned char port, char * buffer, unsigned char size)
+{
+    if (port == USB_COMM)
+    {
+        portENTER_CRITICAL();
+        {
+            gpSendBuffer = buffer;
+            gSendSize = size;
+            gSendPos = 0;
+        }
+        portEXIT_CRITICAL();
+    }
+}
+
+void serial_send_blocking (unsigned char port, char * buffer, unsigned char size)
+{
+    serial_send (port, buffer, size);
+    while (!serial_send_buffer_empty (port))
+    {
+        serial_check();
+    }
+}
+
+char serial_send_buffer_empty (unsigned char port)
+{
+    return port != USB_COMM || gSendPos >= gSendSize;
+}
+
+/* Shuffle bytes between the auxiliary processor and the application's buffers */
+void serial_check (void)
+{
+    unsigned char numToSend;
+
+    portENTER_CRITICAL();
+    pthread_mutex_lock (&gSerialMutex);
+    {
+        if (gpReceiveRing != PNULL)
+        {
+            while (gAuxReceiveCount > 0)
+            {
+                char c = gAuxReceiveFifo[gAuxReceiveReadPos];
+
+                gpReceiveRing[gReceiveRingPos] = c;
+                gReceiveRingPos++;
+                if (gReceiveRingPos >= gReceiveRingSize)
+                {
+                    gReceiveRingPos = 0;
+                }
+                gAuxReceiveReadPos = (gAuxReceiveReadPos + 1) % sizeof (gAuxReceiveFifo);
+                gAuxReceiveCount--;
+                if (gpReceiveCallback != PNULL)
+                {
+                    gpReceiveCallback (USB_COMM, c);
+                }
+            }
+            pthread_cond_signal (&gSerialCondition);
+        }
+
+        auxDrainSend();
+        numToSend = gSendSize - gSendPos;
+        if (numToSend > UART_SEND_BUFF_SZ - gAuxSendCount)
+        {
+            numToSend = UART_SEND_BUFF_SZ - gAuxSendCount;
+        }
+        if (numToSend > 0)
+        {
+            writeAll (STDOUT_FILENO, gpSendBuffer + gSendPos, numToSend);
+            gSendPos += numToSend;
+            gAuxSendCount += numToSend;
+            if (gSendPos >= gSendSize && gpSendCallback != PNULL)
+            {
+                gpSendCallback (USB_COMM);
+            }
+        }
+    }
+    pthread_mutex_unlock (&gSerialMutex);
+    portEXIT_CRITICAL();
+}
+
+/* OrangutanX2 */
+
+/* Set a motor's drive; call in a critical section with the encoders brought up to date */
+static void setMotor (unsigned char x, unsigned char operation_mode, int speed)
+{
+    gMotorMode[x] = operation_mode;
+    gMotorSpeed[x] = operation_mode == BRAKE_LOW ? 0 : speed;
+}
+
+static void logMotors (void)
+{
+    char string[48];
+
+    snprintf (string, sizeof (string), "M1 %s %d, M2 %s %d", gMotorMode[0] == BRAKE_LOW ? "brake" : "drive", gMotorSpeed[0], gMotorMode[1] == BRAKE_LOW ? "brake" : "drive", gMotorSpeed[1]);
+    logString ("MOTOR", string);
+}
+
+void x2_set_motor (unsigned char motor, unsigned char operation_mode, int speed)
+{
+    unsigned char x;
+
+    portENTER_CRITICAL();
+    {
+        encodersUpdate();
+        for (x = 0; x < NUM_MOTORS; x++)
+        {
+            if (motor == x || motor == JOINT_MOTOR)
+            {
+                setMotor (x, operation_mode, speed);
+            }
+        }
+        logMotors();
+    }
+    portEXIT_CRITICAL();
+}
+
+/* Both motors change at the same instant, as near as the real X2 gets to it */
+void x2_set_motors (unsigned char m1_operation_mode, int m1_speed, unsigned char m2_operation_mode, int m2_speed)
+{
+    portENTER_CRITICAL();
+    {
+        encodersUpdate();
+        setMotor (MOTOR1, m1_operation_mode, m1_speed);
+        setMotor (MOTOR2, m2_operation_mode, m2_speed);
+        logMotors();
+    }
+    portEXIT_CRITICAL();
+}
+
+unsigned char x2_get_motor_current (unsigned char motor)
+{
+    double current = 0;
+    double behind;
+
+    portENTER_CRITICAL();
+    {
+        encodersUpdate();
+        if (motor < NUM_MOTORS && gMotorMode[motor] != BRAKE_LOW && gMotorSpeed[motor] != 0)
+        {
+            /* How far, in O units of drive, the wheel is short of where a motor
+             * that performs as this one does would have it */
+            behind = fabs (gMotorSpeed[motor]);
+            if (gMotorPercent[motor] > 0)
+            {
+                behind -= fabs (gWheelSpeed[motor]) * 100.0 / gMotorPercent[motor];
+            }
+            current = CURRENT_NO_LOAD + (behind > 0 ? behind * CURRENT_PER_O_UNIT : 0);
+        }
+    }
+    portEXIT_CRITICAL();
+
+    return current > CURRENT_MAX ? CURRENT_MAX : (unsigned char) current;
+}
+
+/* Fill the EEPROM from its file, if it has one, the first time it's used */
+static void eepromLoad (void)
+{
+    FILE * pFile;
+
+    if (!gEepromLoaded)
+    {
+        memset (gEeprom, 0xFF, sizeof (gEeprom));
+        gpEepromFileName = getenv ("ROB_HOST_EEPROM");
+        if (gpEepromFileName != PNULL)
+        {
+            pFile = fopen (gpEepromFileName, "rb");
+            if (pFile != PNULL)
+            {
+                if (fread (gEeprom, 1, sizeof (gEeprom), pFile) < sizeof (gEeprom))
+                {
+                    /* A short file leaves the rest blank */
+                }
+                fclose (pFile);
+            }
+        }
+        gEepromLoaded = true;
+    }
+}
+
+void x2_save_eeprom_byte (unsigned int address, unsigned char data)
+{
+    FILE * pFile;
+
+    eepromLoad();
+    if (address > EEPROM_LAST_PARAMETER_ADDRESS && address < EEPROM_SIZE)
+    {
+        busyWaitUs (EEPROM_WRITE_TIME_US);
+        gEeprom[address] = data;
+        if (gpEepromFileName != PNULL)
+        {
+            pFile = fopen (gpEepromFileName, "wb");
+            if (pFile != PNULL)
+            {
+                fwrite (gEeprom, 1, sizeof (gEeprom), pFile);
+                fclose (pFile);
+            }
+        }
+    }
+}
+
+unsigned char x2_read_eeprom_byte (unsigned int address)
+{
+    eepromLoad();
+
+    return address < EEPROM_SIZE ? gEeprom[address] : 0xFF;
+}
+
+/* PololuWheelEncoders */
+
+void encoders_init (unsigned char m1a, unsigned char m1b, unsigned char m2a, unsigned char m2b)
+{
+    portENTER_CRITICAL();
+    {
+        encodersUpdate();
+        gEncoderCounts[0] = 0;
+        gEncoderCounts[1] = 0;
+    }
+    portEXIT_CRITICAL();
+}
+
+int encoders_get_counts_m1 (void)
+{
+    return encoderCounts (0, false);
+}
+
+int encoders_get_counts_m2 (void)
+{
+    return encoderCounts (1, false);
+}
+
+int encoders_get_counts_and_reset_m1 (void)
+{
+    return encoderCounts (0, true);
+}
+
+int encoders_get_counts_and_reset_m2 (void)
+{
+    return encoderCounts (1, true);
+}
+
+unsigned char encoders_check_error_m1 (void)
+{
+    return 0;
+}
+
+unsigned char encoders_check_error_m2 (void)
+{
+    return 0;
+}
+
+/* avr-libc */
+
+char * utoa (unsigned int value, char * pString, int radix)
+{
+    char digits[8 * sizeof (int) + 1];
+    unsigned char numDigits = 0;
+    char * pWrite = pString;
+
+    do
+    {
+        unsigned int digit = value % radix;
+        digits[numDigits] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        numDigits++;
+        value /= radix;
+    }
+    while (value != 0);
+
+    while (numDigits > 0)
+    {
+        numDigits--;
+        *pWrite = digits[numDigits];
+        pWrite++;
+    }
+    *pWrite = 0;
+
+    return pString;
+}
+
+char * itoa (int value, char * pString, int radix)
+{
+    if (value < 0 && radix == 10)
+    {
+        *pString = '-';
+        utoa (-(unsigned int) value, pString + 1, radix);
+    }
+    else
+    {
+        utoa ((unsigned int) value, pString, radix);
+    }
+
+    return pString;
+}
+
+char * ltoa (long value, char * pString, int radix)
+{
+    char digits[8 * sizeof (long) + 1];
+    unsigned char numDigits = 0;
+    unsigned long magnitude = (unsigned long) value;
+    char * pWrite = pString;
+
+    if (value < 0 && radix == 10)
+    {
+        *pWrite = '-';
+        pWrite++;
+        magnitude = -magnitude;
+    }
+
+    do
+    {
+        unsigned int digit = magnitude % radix;
+        digits[numDigits] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        numDigits++;
+        magnitude /= radix;
+    }
+    while (magnitude != 0);
+
+    while (numDigits > 0)
+    {
+        numDigits--;
+        *pWrite = digits[numDigits];
+        pWrite++;
+    }
+    *pWrite = 0;
+
+    return pString;
+}
+
+/* FreeRTOS */
+
+void vApplicationIdleHook (void)
+{
+    /* Show the display once whoever was writing to it has finished */
+    lcdShow();
+
+    /* Nothing to do until the next tick, so don't spin a host CPU */
+    usleep (configTICK_RATE_HZ > 1000 ? 1 : 1000000 / configTICK_RATE_HZ);
+}
@@ -0,0 +1,26 @@
+/* Distance sensor test - part of an application for the Pololu Orangutan X2
+ *
+ * Runs the application's own adcToDistanceMm() (rob_distance.c, over the table in
+ * sharp_data.c) for every 10-bit ADC code and prints "code mm" a line at a time,
+ * for gen_sharp_data.py --check to hold against the data sheet's curve, e.g.:
+ *
+ *   ./build/test_sharp_data | python3 gen_sharp_data.py --check
+ */
+
+#include <stdio.h>
+#include <rob_system.h>
+#include <rob_distance.h>
+
+#define ADC_MAX_CODE 1023
+
+int main (void)
+{
+    unsigned int code;
+
+    for (code = 0; code <= ADC_MAX_CODE; code++)
+    {
+        printf ("%u %u\n", code, adcToDistanceMm (code));
+    }
+
+    return 0;
+}
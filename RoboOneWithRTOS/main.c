@@ -17,21 +17,40 @@
  * Stop
  * Home
  * Info?
+ * Pose?
+ * Calibration["setting value"|"save"|"load"|"defaults"]
  * Echo
  * A"xxx"
  * T"xxx"
  * !
- * *
+ * *["ms cm"]
+ * X
  *
  * Commands can be single letters, we only look for a numeric character, Forwards and
  * Backwards can be in units of metres or metres per second, turns can be 90 degrees
  * or a deviation in degrees.  Home is the "return to charger" command and only works
  * if the robot is in sight of the charger. Info? returns a standard set of
- * status information.  Echo is used purely for testing and causes every received
- * command to be echoed without action (until reset). A is followed immediately
- * by a quoted Alphanumeric string that will be shown on the LCD display. T is
- * like A but the contents of the string is a Tune string.  "!" just causes an
- * OK response.  * causes all of the distance sensors to be read and returned.
+ * status information.  Pose? returns where wheel odometry reckons the robot
+ * is, relative to where it was switched on.  Calibration on its own returns the
+ * tunable settings in use (wheel geometry, speed loop and motion profile gains, turn
+ * speed, homing thresholds, motor current limits and how near an obstacle in the way
+ * may come before the robot brakes by itself) and whether they are as saved; with a quoted setting
+ * name and value it changes one at once, "save" keeps them in EEPROM to be loaded at
+ * every start, "load" goes back to what was saved and "defaults" to what was built
+ * in.  Echo is used purely for testing and
+ * causes every received command to be echoed without action (until reset). A is
+ * followed immediately by a quoted Alphanumeric string that will be shown on the
+ * LCD display. T is like A but the contents of the string is a Tune string.  "!"
+ * just causes an OK response.  * causes all of the distance sensors to be read and returned.
+ * With a quoted number of ms it instead subscribes to them: a frame such as
+ * "=280000000000" (the six sensors' distances in cm, in hex, 00 for nothing there)
+ * is then pushed every that many ms, 20 at the least, until *"0"; a second number
+ * sends a frame only once a sensor has moved by that many cm, or once a second.
+ * X switches the serial port, once it has said OK, to a binary protocol: each command
+ * is then a COBS encoded frame, ended by a zero byte, carrying the fields of a coded
+ * command (see processBinaryCommand()) and a CRC-16.  What is sent back comes in
+ * frames of the same sort: OK, Error and Busy as a single byte, 0, 1 or 2, anything
+ * else as the same text as ever.  X in a frame switches back.
  * If a command is prefixed by # and a number then the responses from the
  * controller are prefixed with the same tag (so that sequences of commands can
  * be sent and the responses matched up).
@@ -44,18 +63,19 @@
 
 #include <rob_system.h>
 #include <rob_wrappers.h>
+#include <rob_calibration.h>
 #include <rob_comms.h>
+#include <rob_current.h>
 #include <rob_processing.h>
 #include <rob_motion.h>
 #include <rob_sensor.h>
+#include <rob_latency.h>
 #include <rob_home.h>
 
 #include <FreeRTOS.h>
 #include <task.h>
 #include <queue.h>
 
-#define COMMS_RECEIVE_QUEUE_SIZE 8
-#define COMMS_TRANSMIT_QUEUE_SIZE 8
 #define HELLO_STRING "RoboOne started.\r\n"
 #define HELLO_STRING_NO_TERMINATOR "RoboOne started."
 #define HELLO_TUNE ">g32>>c32"
@@ -77,12 +97,17 @@ xQueueHandle xSensorCommandQueue;
 /* Queue for home state machine events */
 xQueueHandle xHomeEventQueue;
 
+/* The tasks, indexed by TaskId, so that Info can say how much of its stack each has never touched */
+xTaskHandle xTaskHandles[NUM_TASKS];
+
 /* - STATIC FUNCTIONS ----------------------------------------------------------------- */
 
 /* One-time initialisation */
 static void startStuff (void)
 {
-	rob_wait_play_from_program_space (PSTR(HELLO_TUNE));  /* Play welcoming notes */
+    wrappersInit();
+
+	rob_play_from_program_space (PSTR(HELLO_TUNE), PNULL);  /* Play welcoming notes once the scheduler is going */
 
     /* Sort the display */
 #if 0
@@ -93,6 +118,15 @@ static void startStuff (void)
     /* Sort the serial port */
     commsInit();
 
+    /* Load the tunable settings, which the motors need */
+    calibrationInit();
+
+    /* Sort the motors */
+    motionInit();
+
+    /* Get the distance sensors sampling */
+    sensorInit();
+
     /* Say hello */
     rob_print_from_program_space (PSTR(HELLO_STRING_NO_TERMINATOR));
     rob_serial_send_blocking_usb_comm (HELLO_STRING, RobStrlen(HELLO_STRING));
@@ -115,16 +149,31 @@ int main()
         ASSERT_STRING (xSensorCommandQueue, "Could not create xSensorCommandQueue");
         xHomeEventQueue = xQueueCreate (HOME_EVENT_QUEUE_SIZE, sizeof (HomeEvent));
         ASSERT_STRING (xHomeEventQueue, "Could not create xHomeEventQueue");
-        xCommsTransmitQueue = xQueueCreate (COMMS_TRANSMIT_QUEUE_SIZE, sizeof (char *));
+        xCommsTransmitQueue = xQueueCreate (COMMS_TRANSMIT_QUEUE_SIZE, sizeof (CommsTransmitDescriptor));
         ASSERT_STRING (xCommsTransmitQueue, "Could not create xCommsTransmitQueue");
 
-        /* Create the tasks */
-        xTaskCreate (vTaskMotion, (signed char * const) "MotionTask", 500, PNULL, 1, NULL);
-        xTaskCreate (vTaskHome, (signed char * const) "HomeTask", 500, PNULL, 2, NULL);
-        xTaskCreate (vTaskSensor, (signed char * const) "SensorTask", 500, PNULL, 3, NULL); /* Higher than motion so that we don't bump into things */
-        xTaskCreate (vTaskProcessing, (signed char * const) "ProcessingTask", 500, PNULL, 4, NULL); /* Higher than motion so that we can interrupt it */
-        xTaskCreate (vTaskCommsTransmit, (signed char * const) "CommsTransmitTask", 500, PNULL, 5, NULL);
-        xTaskCreate (vTaskCommsReceive, (signed char * const) "CommsReceiveTask", 500, PNULL, 6, NULL);
+        /* Create the tasks; FreeRTOS quietly caps a priority at configMAX_PRIORITIES - 1,
+         * which is sized so that none here needs capping.  On the AVR an interrupt uses
+         * the stack of whichever task it lands in, so every stack has to hold the task's
+         * deepest calls plus a full context save and the tick's trip through the kernel,
+         * around 80 bytes, on top.  Where a stack isn't the 500 of the original tasks it is
+         * sized that way, from the deepest path: for the sensor filter and current monitor
+         * that is sending an event, a 32 byte string and five calls down to a queue send
+         * that may switch task.  Info reports what each has never used, which is the
+         * figure to trim them by on the X2 (the host sim runs its tasks on thread stacks,
+         * so there the figure means nothing). */
+        xTaskCreate (vTaskMotion, (signed char * const) "MotionTask", 500, PNULL, 1, &xTaskHandles[TASK_MOTION]);
+        xTaskCreate (vTaskMotionControl, (signed char * const) "MotionControlTask", 260, PNULL, configMAX_PRIORITIES - 1, &xTaskHandles[TASK_MOTION_CONTROL]); /* Highest, and alone there, it has to keep time */
+        xTaskCreate (vTaskHome, (signed char * const) "HomeTask", 500, PNULL, 2, &xTaskHandles[TASK_HOME]);
+        xTaskCreate (vTaskSensor, (signed char * const) "SensorTask", 500, PNULL, 3, &xTaskHandles[TASK_SENSOR]); /* Higher than motion so that we don't bump into things */
+        xTaskCreate (vTaskSensorFilter, (signed char * const) "SensorFilterTask", 300, PNULL, 3, &xTaskHandles[TASK_SENSOR_FILTER]); /* Likewise */
+        xTaskCreate (vTaskCurrentMonitor, (signed char * const) "CurrentMonitorTask", 300, PNULL, 3, &xTaskHandles[TASK_CURRENT_MONITOR]); /* Higher than motion so that a jam is caught whatever it's doing */
+        xTaskCreate (vTaskProcessing, (signed char * const) "ProcessingTask", 500, PNULL, 4, &xTaskHandles[TASK_PROCESSING]); /* Higher than motion so that we can interrupt it */
+        xTaskCreate (vTaskCommsTransmit, (signed char * const) "CommsTransmitTask", 500, PNULL, 5, &xTaskHandles[TASK_COMMS_TRANSMIT]);
+        xTaskCreate (vTaskCommsReceive, (signed char * const) "CommsReceiveTask", 500, PNULL, 6, &xTaskHandles[TASK_COMMS_RECEIVE]);
+        xTaskCreate (vTaskBuzzer, (signed char * const) "BuzzerTask", 200, PNULL, tskIDLE_PRIORITY + 1, &xTaskHandles[TASK_BUZZER]);
+        xTaskCreate (vTaskLcdFlush, (signed char * const) "LcdFlushTask", 200, PNULL, tskIDLE_PRIORITY, &xTaskHandles[TASK_LCD_FLUSH]); /* Lowest, the display can wait */
+        xTaskCreate (vTaskLatencyProbe, (signed char * const) "LatencyProbeTask", 140, PNULL, configMAX_PRIORITIES - 2, &xTaskHandles[TASK_LATENCY_PROBE]); /* Above everything but motion control */
 
         /* Start the scheduler */
         vTaskStartScheduler();
@@ -137,7 +186,14 @@ int main()
 
 void vApplicationStackOverflowHook (xTaskHandle taskHandle, char * pName)
 {
+    /* The kernel calls this while switching tasks and the one that overflowed may have
+     * trampled anything, a mutex that the LCD wrappers would wait on included: with
+     * interrupts off for good, go round the mutexes straight to the display */
+    portDISABLE_INTERRUPTS();
+    rob_panic();
+    rob_clear();
     rob_print_from_program_space (PSTR("Stack overflow in "));
     rob_print (pName);
+    rob_lcd_flush();
     while (1);
 }
\ No newline at end of file
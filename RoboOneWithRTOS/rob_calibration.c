@@ -0,0 +1,340 @@
+/* Calibration - the tunable settings part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+/* The settings live in RAM, loaded once at boot from a record in the EEPROM of the
+ * X2's auxiliary processor: a version byte, the settings (low byte first) and a CRC
+ * over both.  If the record is missing, corrupt or from another version the defaults
+ * below are used instead, so a blank or newly reflashed robot still works.  Changes
+ * made over the serial port take effect at once; they survive a reset once saved. */
+
+#include <rob_system.h>
+#include <rob_wrappers.h>
+#include <rob_motion.h>
+#include <rob_calibration.h>
+#include <rob_crc.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <pololu/orangutan.h>
+
+#define CALIBRATION_VERSION 3
+
+/* The record goes at the top of the X2's 512 bytes of EEPROM, which is otherwise
+ * melody space: any melodies stored on the X2 must end below this */
+#define CALIBRATION_EEPROM_ADDRESS 480
+#define CALIBRATION_RECORD_SIZE (1 + NUM_CALIBRATION_FIELDS * 2 + 2)
+
+/* - GLOBALS -------------------------------------------------------------------------- */
+
+/* The names the settings go by on the serial port, in CalibrationField order */
+static const char gCalibrationNames[NUM_CALIBRATION_FIELDS][CALIBRATION_NAME_SIZE] PROGMEM =
+{
+    "circ",
+    "base",
+    "kp",
+    "ki",
+    "accel",
+    "vmin",
+    "turn",
+    "htravel",
+    "hrough",
+    "hfine",
+    "iover",
+    "istall",
+    "tstall",
+    "reflex"
+};
+
+/* What the settings are until told otherwise, in CalibrationField order */
+static const unsigned int gCalibrationDefaults[NUM_CALIBRATION_FIELDS] PROGMEM =
+{
+    WHEEL_CIRCUMFERENCE_MM,
+    WHEEL_BASE_MM,
+    4,   /* Speed loop gains: O units of drive per encoder count (per period of speed */
+    128, /* error, or of accumulated distance error), times 16 */
+    600, /* Motion profile: how hard the speed loop's setpoints speed up and slow down, */
+    40,  /* and the crawl at the end of a goal, slow enough to stop on the spot */
+    80,  /* Drive for turning on the spot */
+    10,  /* Difference in count between the left and right IR sensors (over the */
+    30,  /* integration period) that homing would like to achieve when travelling, */
+    10,  /* with rough alignment and with fine alignment */
+    11,  /* Motor current, in the X2's units, that brakes at once, that brakes if it */
+    3,   /* lasts and how many ms it must last; see below */
+    500,
+    80   /* How near, in mm, something in the way has to be for the obstacle reflex to brake */
+};
+
+/* Where the current defaults come from.  The X2 reads each VNH2SP30's current sense
+ * output with 8 bits over 5 V, 19.6 mV a unit; the VNH2SP30 sources 1/11370 (typical)
+ * of the motor current into a 1.5 kohm resistor, 0.13 V an amp, so a unit is about
+ * 150 mA.  The 42x19 mm wheels with Pololu's 48 count encoders go on high-power
+ * micro metal gearmotors, which at 6 V run free at 0.12 A, under one unit, and
+ * stall at 1.6 A, 11 units.  So:
+ * - overcurrent at 11, the full stall current, which nothing but a jam at or near
+ *   full drive reaches;
+ * - stall at 3, 0.45 A, which is what a jam at the 80 O units of drive that turning
+ *   uses draws, nearly four times what a motor turning freely does;
+ * - 500 ms of it, as long as the motion profile takes at its default 600 mm/s/s to
+ *   get the wheels from rest to 300 mm/s, so that starting off, with the wheels
+ *   short of their setpoints, doesn't count as a stall.
+ * Neither current limit can go below 2, 0.3 A, so that a motor that's merely turning
+ * can't trip it. */
+#define CURRENT_LIMIT_MINIMUM 2
+
+/* The range each setting may be given, in CalibrationField order; these keep the
+ * sums that use them from overflowing or dividing by zero */
+static const unsigned int gCalibrationMinimums[NUM_CALIBRATION_FIELDS] PROGMEM =
+{
+    50, 50, 0, 1, 100, 10, MINIMUM_USEFUL_SPEED_O_UNITS, 0, 0, 0, CURRENT_LIMIT_MINIMUM, CURRENT_LIMIT_MINIMUM, 0, 0
+};
+static const unsigned int gCalibrationMaximums[NUM_CALIBRATION_FIELDS] PROGMEM =
+{
+    400, 400, 255, 1024, 5000, 200, 255, 1000, 1000, 1000, 255, 255, 10000, 400
+};
+
+/* The settings in use */
+static unsigned int gCalibration[NUM_CALIBRATION_FIELDS];
+static CalibrationState gCalibrationState = CALIBRATION_STATE_DEFAULTS;
+
+/* - STATIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* Put the settings into a record as it is stored in EEPROM */
+static void encodeRecord (const unsigned int * pSettings, unsigned char * pRecord)
+{
+    unsigned char x;
+    unsigned char pos = 0;
+    unsigned int crc;
+
+    pRecord[pos] = CALIBRATION_VERSION;
+    pos++;
+    for (x = 0; x < NUM_CALIBRATION_FIELDS; x++)
+    {
+        pRecord[pos] = (unsigned char) pSettings[x];
+        pRecord[pos + 1] = (unsigned char) (pSettings[x] >> 8);
+        pos += 2;
+    }
+    crc = crc16 (pRecord, pos);
+    pRecord[pos] = (unsigned char) crc;
+    pRecord[pos + 1] = (unsigned char) (crc >> 8);
+}
+
+/* Get the settings out of a record read from EEPROM; returns false, leaving
+ * pSettings alone, if it's not a valid one of this version */
+static bool decodeRecord (const unsigned char * pRecord, unsigned int * pSettings)
+{
+    unsigned char x;
+    unsigned char pos = 1 + NUM_CALIBRATION_FIELDS * 2;
+    unsigned int crc = crc16 (pRecord, pos);
+    unsigned int value;
+
+    if (pRecord[0] != CALIBRATION_VERSION || pRecord[pos] != (unsigned char) crc || pRecord[pos + 1] != (unsigned char) (crc >> 8))
+    {
+        return false;
+    }
+
+    /* A setting that's out of range can't have been saved by this version */
+    for (x = 0; x < NUM_CALIBRATION_FIELDS; x++)
+    {
+        value = pRecord[1 + x * 2] | ((unsigned int) pRecord[2 + x * 2] << 8);
+        if (value < pgm_read_word (&gCalibrationMinimums[x]) || value > pgm_read_word (&gCalibrationMaximums[x]))
+        {
+            return false;
+        }
+    }
+    for (x = 0; x < NUM_CALIBRATION_FIELDS; x++)
+    {
+        pSettings[x] = pRecord[1 + x * 2] | ((unsigned int) pRecord[2 + x * 2] << 8);
+    }
+
+    return true;
+}
+
+/* Read the record from EEPROM */
+static void readRecord (unsigned char * pRecord)
+{
+    unsigned char x;
+
+    for (x = 0; x < CALIBRATION_RECORD_SIZE; x++)
+    {
+        pRecord[x] = rob_x2_read_eeprom_byte (CALIBRATION_EEPROM_ADDRESS + x);
+    }
+}
+
+/* Find a setting by name; returns NUM_CALIBRATION_FIELDS if there isn't one */
+static CalibrationField findField (const char * pName)
+{
+    unsigned char x;
+    unsigned char y;
+    char c;
+
+    for (x = 0; x < NUM_CALIBRATION_FIELDS; x++)
+    {
+        for (y = 0; y < CALIBRATION_NAME_SIZE; y++)
+        {
+            c = pgm_read_byte (&gCalibrationNames[x][y]);
+            if (pName[y] != c)
+            {
+                break;
+            }
+            if (c == 0)
+            {
+                return (CalibrationField) x;
+            }
+        }
+    }
+
+    return NUM_CALIBRATION_FIELDS;
+}
+
+/* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* Load the settings, falling back on the defaults; call before the scheduler starts */
+void calibrationInit (void)
+{
+    restoreCalibrationDefaults();
+    loadCalibration();
+}
+
+/* Get a setting; any task may call this */
+unsigned int getCalibration (CalibrationField field)
+{
+    unsigned int value;
+
+    ASSERT_PARAM (field < NUM_CALIBRATION_FIELDS, field);
+
+    portENTER_CRITICAL();
+    {
+        value = gCalibration[field];
+    }
+    portEXIT_CRITICAL();
+
+    return value;
+}
+
+/* Change the setting called pName, in RAM only.  Returns false if there is no such
+ * setting or the value is out of its range. */
+bool setCalibration (const char * pName, unsigned int value)
+{
+    CalibrationField field = findField (pName);
+
+    if (field >= NUM_CALIBRATION_FIELDS ||
+        value < pgm_read_word (&gCalibrationMinimums[field]) ||
+        value > pgm_read_word (&gCalibrationMaximums[field]))
+    {
+        return false;
+    }
+
+    portENTER_CRITICAL();
+    {
+        if (gCalibration[field] != value)
+        {
+            gCalibration[field] = value;
+            gCalibrationState = CALIBRATION_STATE_UNSAVED;
+        }
+    }
+    portEXIT_CRITICAL();
+
+    return true;
+}
+
+/* Copy the name of a setting into pName, which must have room for CALIBRATION_NAME_SIZE */
+void getCalibrationName (CalibrationField field, char * pName)
+{
+    unsigned char x;
+
+    ASSERT_PARAM (field < NUM_CALIBRATION_FIELDS, field);
+
+    for (x = 0; x < CALIBRATION_NAME_SIZE; x++)
+    {
+        pName[x] = pgm_read_byte (&gCalibrationNames[field][x]);
+    }
+}
+
+CalibrationState getCalibrationState (void)
+{
+    return gCalibrationState;
+}
+
+/* Replace the settings in use with those saved in EEPROM.  Returns false, leaving
+ * the settings alone, if there aren't any. */
+bool loadCalibration (void)
+{
+    unsigned char record[CALIBRATION_RECORD_SIZE];
+    unsigned int settings[NUM_CALIBRATION_FIELDS];
+    bool success;
+
+    readRecord (record);
+    success = decodeRecord (record, settings);
+    if (success)
+    {
+        portENTER_CRITICAL();
+        {
+            RobMemcpy (gCalibration, settings, sizeof (gCalibration));
+            gCalibrationState = CALIBRATION_STATE_STORED;
+        }
+        portEXIT_CRITICAL();
+    }
+
+    return success;
+}
+
+/* Save the settings in use to EEPROM and check that they read back.  Each byte takes
+ * the X2 a few ms to write, so this is best done with the robot still. */
+bool saveCalibration (void)
+{
+    unsigned char record[CALIBRATION_RECORD_SIZE];
+    unsigned char readBack[CALIBRATION_RECORD_SIZE];
+    unsigned int settings[NUM_CALIBRATION_FIELDS];
+    unsigned char x;
+    bool success;
+
+    portENTER_CRITICAL();
+    {
+        RobMemcpy (settings, gCalibration, sizeof (settings));
+    }
+    portEXIT_CRITICAL();
+
+    encodeRecord (settings, record);
+    for (x = 0; x < CALIBRATION_RECORD_SIZE; x++)
+    {
+        rob_x2_save_eeprom_byte (CALIBRATION_EEPROM_ADDRESS + x, record[x]);
+    }
+    readRecord (readBack);
+    success = (memcmp (record, readBack, sizeof (record)) == 0);
+
+    portENTER_CRITICAL();
+    {
+        /* Unless it was changed again meanwhile */
+        if (success && memcmp (settings, gCalibration, sizeof (settings)) == 0)
+        {
+            gCalibrationState = CALIBRATION_STATE_STORED;
+        }
+    }
+    portEXIT_CRITICAL();
+
+    return success;
+}
+
+/* Put the settings back to their defaults, in RAM only */
+void restoreCalibrationDefaults (void)
+{
+    unsigned char x;
+
+    portENTER_CRITICAL();
+    {
+        for (x = 0; x < NUM_CALIBRATION_FIELDS; x++)
+        {
+            gCalibration[x] = pgm_read_word (&gCalibrationDefaults[x]);
+        }
+        gCalibrationState = CALIBRATION_STATE_DEFAULTS;
+    }
+    portEXIT_CRITICAL();
+}
@@ -0,0 +1,50 @@
+/* Calibration - the tunable settings part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+#define CALIBRATION_NAME_SIZE 8 /* The longest name, including its terminator */
+
+/* The settings that can be tuned without a reflash.  Adding one, or changing what one
+ * means, needs CALIBRATION_VERSION in rob_calibration.c moving on. */
+typedef enum CalibrationFieldTag
+{
+    CAL_WHEEL_CIRCUMFERENCE_MM = 0,
+    CAL_WHEEL_BASE_MM,
+    CAL_SPEED_LOOP_KP_X16,
+    CAL_SPEED_LOOP_KI_X16,
+    CAL_PROFILE_ACCEL_MM_S2,
+    CAL_PROFILE_MIN_SPEED_MM_S,
+    CAL_TURN_SPEED_O_UNITS,
+    CAL_HOME_THRESHOLD_TRAVEL,
+    CAL_HOME_THRESHOLD_ROUGH_ALIGNMENT,
+    CAL_HOME_THRESHOLD_FINE_ALIGNMENT,
+    CAL_OVERCURRENT,
+    CAL_STALL_CURRENT,
+    CAL_STALL_MS,
+    CAL_OBSTACLE_MM,
+    NUM_CALIBRATION_FIELDS
+} CalibrationField;
+
+/* Where the settings in use came from */
+typedef enum CalibrationStateTag
+{
+    CALIBRATION_STATE_DEFAULTS = 0, /* Nothing valid in EEPROM */
+    CALIBRATION_STATE_STORED,       /* As saved in EEPROM */
+    CALIBRATION_STATE_UNSAVED,      /* Changed since, not yet saved */
+    NUM_CALIBRATION_STATES
+} CalibrationState;
+
+void calibrationInit (void);
+unsigned int getCalibration (CalibrationField field);
+bool setCalibration (const char * pName, unsigned int value);
+void getCalibrationName (CalibrationField field, char * pName);
+CalibrationState getCalibrationState (void);
+bool loadCalibration (void);
+bool saveCalibration (void);
+void restoreCalibrationDefaults (void);
\ No newline at end of file
@@ -10,87 +10,326 @@
 
 #include <rob_system.h>
 #include <rob_wrappers.h>
+#include <rob_crc.h>
 #include <rob_comms.h>
 
 #include <FreeRTOS.h>
 #include <task.h>
 #include <queue.h>
+#include <semphr.h>
 
 #define SERIAL_BAUD_RATE 9600
 #define NUM_BYTES_FROM_RECEIVE_RING(nEWpOS, oLDpOS) ((nEWpOS) >= (oLDpOS) ?  ((nEWpOS) - (oLDpOS)) : (sizeof (uartReceiveBuffer) - (oLDpOS) + (nEWpOS)))
 #define COMMAND_TERMINATOR '\n'
+#define FRAME_DELIMITER 0 /* Ends each frame of the binary protocol, COBS keeps it out of the frame itself */
+#define FRAME_OVERHEAD 3 /* What framing adds to a string: the CRC-16 and COBS's first code byte, the delimiter standing in for the terminator */
+#define FRAME_CRC_SIZE 2
+#define COMMS_POLL_IDLE_MS 10 /* How often to poll the X2's auxiliary processor for USB_COMM bytes when the line is quiet */
+#define COMMS_POLL_ACTIVE_MS 1 /* How often to poll it while commands are arriving */
+#define COMMS_ACTIVE_WINDOW_MS 250 /* How long after the last received byte the line counts as busy */
 
 unsigned char uartSendBuffer[128];
-         char uartReceiveBuffer[128]; /* not more than 256, must be bigger than the longest command */
+         char uartReceiveBuffer[COMMS_BUFFER_SIZE]; /* not more than 256, must be bigger than the longest command */
 unsigned char uartReceiveBufferPos = 0;
 unsigned char uartNextCommandStartPos = 0;
 
+/* - GLOBALS -------------------------------------------------------------------------- */
+
+/* The queue that the comms transmit task uses */
+extern xQueueHandle xCommsTransmitQueue;
+
+/* Given by the transmit task when it starts a send, to get the comms receive task to
+ * poll straight away */
+static xSemaphoreHandle xCommsPollSemaphore;
+
+/* Given by the comms receive task when the transmit path has taken the last byte of a send */
+static xSemaphoreHandle xSendDoneSemaphore;
+
+/* True from the transmit task starting a send until the transmit path has taken the last byte */
+static volatile bool gSendInProgress = false;
+
+/* Set by the transmit path when it has taken the last byte of a send, until the comms
+ * receive task has passed that on to the transmit task */
+static volatile bool gSendDone = false;
+
+/* Tick at which the receive path last saw any byte */
+static volatile portTickType gLastReceiveTick = 0;
+
+/* Tick at which the receive path last saw a COMMAND_TERMINATOR */
+static volatile portTickType gTerminatorTick = 0;
+
+/* Whether the serial port is talking the binary framed protocol rather than lines of
+ * text, and so what ends a command: COMMAND_TERMINATOR or FRAME_DELIMITER */
+static volatile bool gCommsBinary = false;
+static volatile char gCommandEnd = COMMAND_TERMINATOR;
+
+/* Histogram of the time from the receive path seeing a command's terminator to the
+ * command being dispatched to the processing task: element x counts commands that took
+ * x ms, the last element counts everything longer */
+static unsigned int gReceiveLatencyHistogram[COMMS_LATENCY_HISTOGRAM_SIZE];
+
+/* A block from the comms buffer pool: while it is free its first bytes link it
+ * into the free list, while it is in use it holds a null terminated string, with
+ * room to turn the longest into a frame where it is */
+typedef union CommsBufferTag
+{
+    union CommsBufferTag * pNextFree;
+    char string[COMMS_BUFFER_SIZE + FRAME_OVERHEAD];
+} CommsBuffer;
+
+/* The comms buffer pool, taken from the heap once at start of day.  Every command
+ * and response is held in one of these from the moment it is built to the moment it
+ * has been dealt with; ownership goes with the pointer through xCommsReceiveQueue and
+ * xCommsTransmitQueue, and whoever takes it off the end of the chain frees it */
+static CommsBuffer * gpCommsBufferPool = PNULL;
+static CommsBuffer * gpCommsBufferFreeList = PNULL;
+
+/* Usage statistics for the comms buffer pool */
+static CommsBufferStats gCommsBufferStats;
+
+/* The constant responses, indexed by CommsResponse and already terminated so that they
+ * can be handed straight to the serial port.  They stay in RAM rather than flash because
+ * USB_COMM sends pick the bytes up from the buffer as the auxiliary processor takes them. */
+static const CommsTransmitDescriptor gCommsResponses[NUM_COMMS_RESPONSES] =
+{
+    {OK_STRING "\n", sizeof (OK_STRING), false},
+    {ERROR_STRING "\n", sizeof (ERROR_STRING), false},
+    {BUSY_STRING "\n", sizeof (BUSY_STRING), false}
+};
+
+/* The same as frames of the binary protocol, made by commsInit(): there each is a
+ * single byte, its CommsResponse, which no line of text can be mistaken for */
+static char gCommsFramedResponseStrings[NUM_COMMS_RESPONSES][1 + FRAME_OVERHEAD + 1];
+static CommsTransmitDescriptor gCommsFramedResponses[NUM_COMMS_RESPONSES];
+
 /* - STATIC FUNCTIONS ----------------------------------------------------------------- */
 
+/* Called by the serial library with each received byte.  USB_COMM has no interrupt,
+ * the library calls this from serial_check(), so from the comms receive task itself:
+ * it only needs to note the time, the task looks for commands as soon as
+ * serial_check() returns */
+static void receiveByteCallback (unsigned char port, unsigned char byteReceived)
+{
+    gLastReceiveTick = xTaskGetTickCount();
+    if (byteReceived == gCommandEnd)
+    {
+        gTerminatorTick = gLastReceiveTick;
+    }
+}
+
+/* Called by the serial library when the last byte of a send has been started, from
+ * serial_check() for USB_COMM.  The library may still be in the middle of shuffling
+ * bytes, so just flag it: the comms receive task gives xSendDoneSemaphore once
+ * serial_check() has returned. */
+static void sendDoneCallback (unsigned char port)
+{
+    /* Blocking sends (e.g. the hello at start of day) end up here too, ignore them */
+    if (gSendInProgress)
+    {
+        gSendInProgress = false;
+        gSendDone = true;
+    }
+}
+
+/* Put a descriptor on the transmit queue, waiting up to xTicksToWait for room; if there
+ * is none its buffer is given back (and counted as dropped) */
+static void queueForTransmit (const CommsTransmitDescriptor * pDescriptor, portTickType xTicksToWait)
+{
+    portBASE_TYPE xStatus;
+
+    xStatus = xQueueSend (xCommsTransmitQueue, pDescriptor, xTicksToWait);
+    if (xStatus != pdPASS)
+    {
+        if (pDescriptor->isPooled)
+        {
+            freeCommsBuffer (pDescriptor->pString);
+        }
+        portENTER_CRITICAL();
+        {
+            gCommsBufferStats.numDropped++;
+        }
+        portEXIT_CRITICAL();
+    }
+}
+
+/* Make the first length bytes of pBuffer into a frame of the binary protocol, where
+ * they are: add their CRC-16 (low byte first), COBS encode the lot, so that there
+ * are no zeroes in it, and end it with FRAME_DELIMITER.  pBuffer must have room for
+ * length + FRAME_OVERHEAD + 1 bytes.  Returns the size of the frame. */
+static unsigned char frameInPlace (char * pBuffer, unsigned char length)
+{
+    unsigned char * pBytes = (unsigned char *) pBuffer;
+    unsigned int crc;
+    unsigned char codePos = 0;
+    unsigned char pos;
+
+    /* Below 254 bytes COBS needs no code bytes but the first and those standing in
+     * for zeroes, so the encoding can go over the top of what it encodes */
+    ASSERT_PARAM (length + FRAME_CRC_SIZE < 254, length);
+
+    crc = crc16 (pBytes, length);
+    pBytes[length] = (unsigned char) crc;
+    pBytes[length + 1] = (unsigned char) (crc >> 8);
+    length += FRAME_CRC_SIZE;
+    RobMemmove (pBytes + 1, pBytes, length);
+
+    /* Each zero becomes the distance to the next, the first byte the distance to the first */
+    for (pos = 1; pos <= length; pos++)
+    {
+        if (pBytes[pos] == 0)
+        {
+            pBytes[codePos] = pos - codePos;
+            codePos = pos;
+        }
+    }
+    pBytes[codePos] = pos - codePos;
+    pBytes[pos] = FRAME_DELIMITER;
+
+    return pos + 1;
+}
+
+/* Put length bytes of text in a comms buffer on the transmit queue, as a line or, in
+ * binary mode, as a frame.  Ownership of the buffer passes to the transmit queue. */
+static void queueCommsBuffer (char * pBuffer, size_t length, portTickType xTicksToWait)
+{
+    CommsTransmitDescriptor descriptor;
+
+    ASSERT_PARAM (length < COMMS_BUFFER_SIZE, length);
+
+    descriptor.pString = pBuffer;
+    if (gCommsBinary)
+    {
+        descriptor.size = frameInPlace (pBuffer, length);
+    }
+    else
+    {
+        *(pBuffer + length) = COMMAND_TERMINATOR; /* A terminator that makes sense to a PC comms handler */
+        descriptor.size = length + 1;
+    }
+    descriptor.isPooled = true;
+    queueForTransmit (&descriptor, xTicksToWait);
+}
+
+/* Copy a (null terminated) string into a comms buffer and put it on the transmit queue */
+static void queueString (char * pSendString, size_t size, portTickType xTicksToWait)
+{
+    char * pBuffer;
+
+    ASSERT_PARAM (size <= COMMS_BUFFER_SIZE, size);
+
+    pBuffer = allocCommsBuffer();
+    if (pBuffer)
+    {
+        RobMemcpy (pBuffer, pSendString, size - 1);
+        queueCommsBuffer (pBuffer, size - 1, xTicksToWait);
+    }
+}
+
+/* The descriptor for one of the constant responses, as a line or as a frame */
+static const CommsTransmitDescriptor * getResponseDescriptor (CommsResponse response)
+{
+    ASSERT_PARAM (response < NUM_COMMS_RESPONSES, response);
+
+    return gCommsBinary ? &gCommsFramedResponses[response] : &gCommsResponses[response];
+}
+
+/* Add a dispatch latency to the histogram */
+static void recordReceiveLatency (portTickType latencyTicks)
+{
+    unsigned int latencyMs = latencyTicks * portTICK_RATE_MS;
+
+    if (latencyMs >= COMMS_LATENCY_HISTOGRAM_SIZE)
+    {
+        latencyMs = COMMS_LATENCY_HISTOGRAM_SIZE - 1;
+    }
+    gReceiveLatencyHistogram[latencyMs]++;
+}
+
 /* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
 
 /* The queue that the comms receive task uses */
 extern xQueueHandle xCommsReceiveQueue;
-extern xQueueHandle xCommsTransmitQueue;
 
 /* The Comms receive task */
 void vTaskCommsReceive (void *pvParameters)
 {
     CommandString * pCommandString;
     portBASE_TYPE xStatus;
+    portTickType pollPeriod;
 
     while (1)
     {
-        /* Check for things going on on the USB interface (no interrupts there) */
-        rob_serial_check();
+        /* Wait for the receive path to tell us that a command has arrived.  A UART's RX
+         * interrupt does that by itself but USB_COMM bytes only move when we poll the
+         * auxiliary processor (there's no interrupt from it), so on the X2 we have to wake
+         * up to poll: quickly while commands are coming in, which they tend to do in bursts,
+         * or while there's something to send, slowly once the line has gone quiet. */
+        pollPeriod = COMMS_POLL_IDLE_MS;
+        if (gSendInProgress || (portTickType) (xTaskGetTickCount() - gLastReceiveTick) < COMMS_ACTIVE_WINDOW_MS / portTICK_RATE_MS)
+        {
+            pollPeriod = COMMS_POLL_ACTIVE_MS;
+        }
+        xSemaphoreTake (xCommsPollSemaphore, pollPeriod / portTICK_RATE_MS);
 
-        /* Look for a command and add it to the queue if there is one */
-        pCommandString = receiveSerialCommand();
+        /* Move anything from the USB interface into the receive ring, and anything
+         * being sent out to it */
+        rob_serial_check();
+        if (gSendDone)
+        {
+            gSendDone = false;
+            xSemaphoreGive (xSendDoneSemaphore);
+        }
 
-        if (pCommandString != PNULL)
+        /* Dispatch every complete command, there may be more than one */
+        while ((pCommandString = receiveSerialCommand()) != PNULL)
         {
             rob_clear();
             rob_print_from_program_space (PSTR("Received: "));
-            rob_print (pCommandString);
+            if (!gCommsBinary)
+            {
+                rob_print (pCommandString);
+            }
             xStatus = xQueueSend (xCommsReceiveQueue, &pCommandString, 0);
-            if (xStatus != pdPASS)
+            if (xStatus == pdPASS)
             {
-                sendSerialString (BUSY_STRING, sizeof (BUSY_STRING));
+                recordReceiveLatency (xTaskGetTickCount() - gTerminatorTick);
+            }
+            else
+            {
+                /* Don't wait for room to send the response: it's our polling
+                 * that empties the transmit queue */
+                freeCommsBuffer (pCommandString);
+                queueForTransmit (getResponseDescriptor (COMMS_RESPONSE_BUSY), 0);
             }
         }
-
-        /* Let other tasks run */
-        vTaskDelay (10 / portTICK_RATE_MS);
     }
 }
 
-/* The queue that the comms transmit task uses */
-extern xQueueHandle xCommsTransmitQueue;
-
 /* The Comms transmit task */
 void vTaskCommsTransmit (void *pvParameters)
 {
-    char * pSendString;
+    CommsTransmitDescriptor descriptor;
     portBASE_TYPE xStatus;
 
     while (1)
     {
-        xStatus = xQueueReceive (xCommsTransmitQueue, &pSendString, portMAX_DELAY);
+        xStatus = xQueueReceive (xCommsTransmitQueue, &descriptor, portMAX_DELAY);
 
         ASSERT_STRING (xStatus == pdPASS, "Failed to receive from serial transmit queue.");
 
-        /* Do the sending thang, if we've been given something to send */
-        if (pSendString != PNULL)
-        {
-            unsigned char bytesToSend;
-
-            bytesToSend = RobStrlen (pSendString) + 1; /* +1 because strlen() doesn't include the terminator and we need to send it */
-            *(pSendString + bytesToSend - 1) = COMMAND_TERMINATOR; /* Replace the null terminator with a terminator that makes sense to a PC comms handler */
-             /* Would really prefer not to block here but background send doesn't seem to work reliably under FreeRTOS */
-            rob_serial_send_blocking_usb_comm (pSendString, bytesToSend);
+        /* Send in the background and wait, without holding anyone else off, for the
+         * transmit path to say that it has finished with the buffer; on the X2 it is
+         * the receive task's polling that moves the bytes so give that a kick */
+        gSendInProgress = true;
+        rob_serial_send_usb_comm (descriptor.pString, descriptor.size);
+        xSemaphoreGive (xCommsPollSemaphore);
+        xStatus = xSemaphoreTake (xSendDoneSemaphore, portMAX_DELAY);
+        ASSERT_STRING (xStatus == pdPASS, "Failed to take send done semaphore.");
 
-            /* Free the memory */
-            RobFree (pSendString);
+        /* Give the buffer back, if it came from the pool */
+        if (descriptor.isPooled)
+        {
+            freeCommsBuffer (descriptor.pString);
         }
     }
 }
@@ -98,14 +337,113 @@ void vTaskCommsTransmit (void *pvParameters)
 /* Initialisation */
 void commsInit (void)
 {
+    unsigned char x;
+
+    gpCommsBufferPool = RobMalloc (sizeof (CommsBuffer) * COMMS_NUM_BUFFERS);
+    ASSERT_STRING (gpCommsBufferPool, "Could not allocate comms buffer pool");
+    for (x = 0; x < COMMS_NUM_BUFFERS; x++)
+    {
+        freeCommsBuffer (gpCommsBufferPool[x].string);
+    }
+    gCommsBufferStats.inUse = 0; /* Filling the free list counted down */
+
+    for (x = 0; x < NUM_COMMS_RESPONSES; x++)
+    {
+        gCommsFramedResponseStrings[x][0] = (char) x;
+        gCommsFramedResponses[x].pString = gCommsFramedResponseStrings[x];
+        gCommsFramedResponses[x].size = frameInPlace (gCommsFramedResponseStrings[x], 1);
+        gCommsFramedResponses[x].isPooled = false;
+    }
+
+    vSemaphoreCreateBinary (xCommsPollSemaphore);
+    ASSERT_STRING (xCommsPollSemaphore, "Could not create xCommsPollSemaphore");
+    xSemaphoreTake (xCommsPollSemaphore, 0); /* Binary semaphores are created "given" */
+    vSemaphoreCreateBinary (xSendDoneSemaphore);
+    ASSERT_STRING (xSendDoneSemaphore, "Could not create xSendDoneSemaphore");
+    xSemaphoreTake (xSendDoneSemaphore, 0);
+
     rob_serial_set_baud_rate_usb_comm (SERIAL_BAUD_RATE);
     rob_serial_receive_ring_usb_comm (uartReceiveBuffer, sizeof(uartReceiveBuffer));
+    rob_serial_set_receive_callback_usb_comm (receiveByteCallback);
+    rob_serial_set_send_callback_usb_comm (sendDoneCallback);
+}
+
+/* How long ago, in ms, the receive path last saw a COMMAND_TERMINATOR */
+unsigned int getCommsMsSinceTerminator (void)
+{
+    return (portTickType) (xTaskGetTickCount() - gTerminatorTick) * portTICK_RATE_MS;
+}
+
+/* Copy the command receive latency histogram into pHistogram, which must have room for
+ * COMMS_LATENCY_HISTOGRAM_SIZE entries */
+void getCommsReceiveLatencyHistogram (unsigned int * pHistogram)
+{
+    portENTER_CRITICAL();
+    {
+        RobMemcpy (pHistogram, gReceiveLatencyHistogram, sizeof (gReceiveLatencyHistogram));
+    }
+    portEXIT_CRITICAL();
+}
+
+/* Take a buffer of COMMS_BUFFER_SIZE bytes from the comms buffer pool, returns PNULL
+ * if there are none left.  Safe to call from any task. */
+char * allocCommsBuffer (void)
+{
+    CommsBuffer * pBuffer;
+
+    portENTER_CRITICAL();
+    {
+        pBuffer = gpCommsBufferFreeList;
+        if (pBuffer != PNULL)
+        {
+            gpCommsBufferFreeList = pBuffer->pNextFree;
+            gCommsBufferStats.inUse++;
+            if (gCommsBufferStats.inUse > gCommsBufferStats.highWaterMark)
+            {
+                gCommsBufferStats.highWaterMark = gCommsBufferStats.inUse;
+            }
+        }
+        else
+        {
+            gCommsBufferStats.numDropped++;
+        }
+    }
+    portEXIT_CRITICAL();
+
+    return (char *) pBuffer;
+}
+
+/* Give a buffer from allocCommsBuffer() back to the pool.  Safe to call from any task. */
+void freeCommsBuffer (char * pBuffer)
+{
+    CommsBuffer * pCommsBuffer = (CommsBuffer *) pBuffer;
+
+    ASSERT_PARAM (pCommsBuffer >= gpCommsBufferPool && pCommsBuffer < gpCommsBufferPool + COMMS_NUM_BUFFERS, (unsigned int) (size_t) pBuffer);
+
+    portENTER_CRITICAL();
+    {
+        pCommsBuffer->pNextFree = gpCommsBufferFreeList;
+        gpCommsBufferFreeList = pCommsBuffer;
+        gCommsBufferStats.inUse--;
+    }
+    portEXIT_CRITICAL();
+}
+
+/* Copy the comms buffer pool usage statistics into pStats */
+void getCommsBufferStats (CommsBufferStats * pStats)
+{
+    portENTER_CRITICAL();
+    {
+        *pStats = gCommsBufferStats;
+    }
+    portEXIT_CRITICAL();
 }
 
 /* Look for a command in the receive buffer. */
-/* Returns a pointer to a malloc'ed command string if a command (terminated by COMMAND_TERMINATOR)
+/* Returns a pointer to a comms buffer holding the command string if a command (terminated by COMMAND_TERMINATOR)
  * is found in the buffer, otherwise PNULL.  uartReceiveBufferPos and, if a command is found,
- * uartNexCommandStartPost are moved on by this function.
+ * uartNexCommandStartPost are moved on by this function.  Only the first command is returned,
+ * uartReceiveBufferPos is left just after it, so call again until PNULL is returned.
  */
 CommandString * receiveSerialCommand (void)
 {
@@ -113,20 +451,18 @@ CommandString * receiveSerialCommand (void)
     unsigned char numRxBytes;
     unsigned char x;
     CommandString * pCommandString = PNULL;
-    bool success = true;
 
     newBufferPos = rob_serial_get_received_bytes_usb_comm ();
     numRxBytes = NUM_BYTES_FROM_RECEIVE_RING (newBufferPos, uartReceiveBufferPos);
 
-    for (x = 0; success && x < numRxBytes; x++)
+    for (x = 0; pCommandString == PNULL && x < numRxBytes; x++)
     {
-        if (uartReceiveBuffer[(uartReceiveBufferPos + x) % sizeof (uartReceiveBuffer)] == COMMAND_TERMINATOR)
+        if (uartReceiveBuffer[(uartReceiveBufferPos + x) % sizeof (uartReceiveBuffer)] == gCommandEnd)
         {
             unsigned char commandStringLen;
 
             commandStringLen = NUM_BYTES_FROM_RECEIVE_RING ((uartReceiveBufferPos + x) % sizeof (uartReceiveBuffer), uartNextCommandStartPos) + 1; /* +1 'cos uartNextCommandStartPos was already at character 1 */
-            pCommandString = RobMalloc (commandStringLen);
-            ASSERT_PARAM (pCommandString, commandStringLen);
+            pCommandString = allocCommsBuffer();
             if (pCommandString)
             {
                 unsigned char y;
@@ -134,7 +470,7 @@ CommandString * receiveSerialCommand (void)
 
                 for (y = 0; y < commandStringLen; y++)
                 {
-                    if (uartReceiveBuffer[uartNextCommandStartPos] == '\b') /* handle backspace */
+                    if (uartReceiveBuffer[uartNextCommandStartPos] == '\b' && !gCommsBinary) /* handle backspace, which in a frame is just a byte */
                     {
                         if (writePos > 0)
                         {
@@ -153,35 +489,124 @@ CommandString * receiveSerialCommand (void)
                         uartNextCommandStartPos = 0;
                     }
                 }
-                *(pCommandString + writePos - 1) = 0; /* Make the terminator a null */
+                *(pCommandString + writePos - 1) = 0; /* Make the terminator a null (a frame's delimiter is one already) */
             }
             else
             {
-                success = false;
+                /* No buffer to put it in, all we can do is drop the command (the pool
+                 * statistics count it) and carry on from the next one */
+                uartNextCommandStartPos = (uartReceiveBufferPos + x + 1) % sizeof (uartReceiveBuffer);
             }
         }
     }
 
-    uartReceiveBufferPos = newBufferPos;
+    uartReceiveBufferPos = (uartReceiveBufferPos + x) % sizeof (uartReceiveBuffer);
 
     return pCommandString;
 }
 
-/* Add a (null terminated) string to the transmit queue.  Size must include the terminator. */
+/* The sends below are for a command's reply: they wait for room on the transmit queue,
+ * however long a multi-line reply is, so that none of it, and in particular not the
+ * OK or ERROR that ends it, is lost.  Not for the comms receive task, whose polling is
+ * what empties the queue. */
+
+/* Add a (null terminated) string to the transmit queue.  Size must include the terminator
+ * and be no more than COMMS_BUFFER_SIZE.  If the comms buffer pool is empty the string is
+ * dropped (and counted in the pool statistics). */
 void sendSerialString (char * pSendString, size_t size)
 {
-    char * pMalloc;
-    portBASE_TYPE xStatus;
+    queueString (pSendString, size, portMAX_DELAY);
+}
 
-    pMalloc = RobMalloc (size);
-    if (pMalloc)
+/* Add one of the constant responses to the transmit queue; this needs no buffer and
+ * copies nothing, which matters since most commands are answered with an OK */
+void sendSerialResponse (CommsResponse response)
+{
+    queueForTransmit (getResponseDescriptor (response), portMAX_DELAY);
+}
+
+/* Add a (null terminated) string that is already in a comms buffer to the transmit
+ * queue without copying it, as a line or, in binary mode, as a frame.  Ownership of
+ * the buffer passes to the transmit queue. */
+void sendCommsBuffer (char * pBuffer)
+{
+    queueCommsBuffer (pBuffer, RobStrlen (pBuffer), portMAX_DELAY);
+}
+
+/* The same for what a task sends of its own accord, events and telemetry: rather than
+ * hold up a task that has sensing to do these are dropped (and counted in the pool
+ * statistics) if the transmit queue is full */
+void sendUnsolicitedString (char * pSendString, size_t size)
+{
+    queueString (pSendString, size, 0);
+}
+
+void sendUnsolicitedCommsBuffer (char * pBuffer)
+{
+    queueCommsBuffer (pBuffer, RobStrlen (pBuffer), 0);
+}
+
+/* Switch the serial port between lines of text and the binary framed protocol.  What
+ * is already on the transmit queue goes as it was queued, so a command's response
+ * should be queued before it switches.  Only the processing task should call this. */
+void setCommsBinary (bool binary)
+{
+    gCommsBinary = binary;
+    gCommandEnd = binary ? FRAME_DELIMITER : COMMAND_TERMINATOR;
+}
+
+bool isCommsBinary (void)
+{
+    return gCommsBinary;
+}
+
+/* Check and decode, in place, a frame of the binary protocol as received (COBS
+ * encoded, its delimiter made the null terminator): the payload is left at the start
+ * of pFrame, with a null after it.  Returns the size of the payload, or 0 if the
+ * frame was mangled or its CRC-16 doesn't match. */
+unsigned char decodeCommsFrame (char * pFrame)
+{
+    unsigned char * pBytes = (unsigned char *) pFrame;
+    unsigned char readPos = 0;
+    unsigned char writePos = 0;
+    unsigned char code;
+    unsigned char x;
+    unsigned int crc;
+
+    /* Each code byte says how far on the next zero is; the decoding is never longer
+     * than the encoding so it can go over the top of it */
+    while (pBytes[readPos] != 0)
     {
-        RobMemcpy (pMalloc, pSendString, size);
-        xStatus = xQueueSend (xCommsTransmitQueue, &pMalloc, 0);
-        ASSERT_STRING (xStatus == pdPASS, "Failed to send to transmit queue.");
+        code = pBytes[readPos];
+        readPos++;
+        for (x = 1; x < code; x++)
+        {
+            if (pBytes[readPos] == 0)
+            {
+                return 0; /* Cut short */
+            }
+            pBytes[writePos] = pBytes[readPos];
+            writePos++;
+            readPos++;
+        }
+        if (code < 0xFF && pBytes[readPos] != 0)
+        {
+            pBytes[writePos] = 0;
+            writePos++;
+        }
     }
-    else
+
+    if (writePos <= FRAME_CRC_SIZE)
     {
-        ASSERT_ALWAYS_PARAM (size);
+        return 0;
     }
+    writePos -= FRAME_CRC_SIZE;
+    crc = crc16 (pBytes, writePos);
+    if (pBytes[writePos] != (unsigned char) crc || pBytes[writePos + 1] != (unsigned char) (crc >> 8))
+    {
+        return 0;
+    }
+    pBytes[writePos] = 0;
+
+    return writePos;
 }
@@ -8,6 +8,35 @@
  * Author: Rob Meades
  */
 
+#define COMMS_LATENCY_HISTOGRAM_SIZE 11 /* 0 to 9 ms and 10 ms or more */
+#define COMMS_BUFFER_SIZE 128 /* The longest command or response, including its terminator */
+#define COMMS_NUM_BUFFERS (COMMS_RECEIVE_QUEUE_SIZE + COMMS_TRANSMIT_QUEUE_SIZE + 4) /* +1 being received, +1 being processed, +1 of its reply waiting for room on the transmit queue, +1 being sent */
+
+/* The constant responses, which are sent without taking a comms buffer */
+typedef enum CommsResponseTag
+{
+    COMMS_RESPONSE_OK = 0,
+    COMMS_RESPONSE_ERROR,
+    COMMS_RESPONSE_BUSY,
+    NUM_COMMS_RESPONSES
+} CommsResponse;
+
+/* What goes on the transmit queue: either one of the constant responses or a buffer
+ * from the comms buffer pool, which the transmit task frees once it has been sent */
+typedef struct CommsTransmitDescriptorTag
+{
+    char * pString;        /* Ends with COMMAND_TERMINATOR rather than a null */
+    unsigned char size;    /* Including the terminator */
+    bool isPooled;
+} CommsTransmitDescriptor;
+
+typedef struct CommsBufferStatsTag
+{
+    unsigned char inUse;
+    unsigned char highWaterMark;
+    unsigned int  numDropped;
+} CommsBufferStats;
+
 typedef char CommandString;
 
 void vTaskCommsReceive (void *pvParameters);
@@ -18,4 +47,28 @@ void commsInit (void);
 
 CommandString * receiveSerialCommand (void);
 
-void sendSerialString (char * pSendString, size_t size);
\ No newline at end of file
+void getCommsReceiveLatencyHistogram (unsigned int * pHistogram);
+
+unsigned int getCommsMsSinceTerminator (void);
+
+char * allocCommsBuffer (void);
+
+void freeCommsBuffer (char * pBuffer);
+
+void getCommsBufferStats (CommsBufferStats * pStats);
+
+void sendSerialString (char * pSendString, size_t size);
+
+void sendSerialResponse (CommsResponse response);
+
+void sendCommsBuffer (char * pBuffer);
+
+void sendUnsolicitedString (char * pSendString, size_t size);
+
+void sendUnsolicitedCommsBuffer (char * pBuffer);
+
+void setCommsBinary (bool binary);
+
+bool isCommsBinary (void);
+
+unsigned char decodeCommsFrame (char * pFrame);
\ No newline at end of file
@@ -0,0 +1,58 @@
+/* CRC - the checksum part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+/* CRC-16/CCITT (polynomial 0x1021, no reflection), as used by the calibration record
+ * in EEPROM and the binary framed protocol on the serial port.  It goes a nibble at
+ * a time from a 16 entry table in flash, which is a quarter of the work of going a
+ * bit at a time for 32 bytes of table, where a byte at a time would need 512. */
+
+#include <rob_system.h>
+#include <rob_crc.h>
+
+#include <pololu/orangutan.h>
+
+#define CRC16_CCITT_INITIAL 0xFFFF
+
+/* - GLOBALS -------------------------------------------------------------------------- */
+
+/* The CRC of each nibble, shifted to the top of the 16 bits */
+static const unsigned int gCrc16Table[16] PROGMEM =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/* - STATIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* Add a byte to a CRC-16/CCITT */
+static unsigned int crc16Update (unsigned int crc, unsigned char byte)
+{
+    /* The masks are for hosts where an int is wider than 16 bits */
+    crc = (crc << 4) ^ pgm_read_word (&gCrc16Table[((crc >> 12) ^ (byte >> 4)) & 0x0F]);
+    crc = (crc << 4) ^ pgm_read_word (&gCrc16Table[((crc >> 12) ^ byte) & 0x0F]);
+
+    return crc & 0xFFFF;
+}
+
+/* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* The CRC-16/CCITT of size bytes at pData */
+unsigned int crc16 (const unsigned char * pData, unsigned char size)
+{
+    unsigned int crc = CRC16_CCITT_INITIAL;
+    unsigned char x;
+
+    for (x = 0; x < size; x++)
+    {
+        crc = crc16Update (crc, pData[x]);
+    }
+
+    return crc;
+}
@@ -0,0 +1,11 @@
+/* CRC - the checksum part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+unsigned int crc16 (const unsigned char * pData, unsigned char size);
\ No newline at end of file
@@ -0,0 +1,163 @@
+/* Current - motor current monitoring part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+/* The X2 keeps a running average of each motor's current (on boards with VNH2SP30
+ * motor drivers, anyway; the VNH3SP30 reads zero).  This samples both, smooths them
+ * further and watches for a motor that is drawing too much, or has been drawing a
+ * stalled motor's current for too long, e.g. because the robot has jammed against
+ * something.  Either way it brakes, abandons whatever was going on and tells the
+ * far end with an unsolicited "EVENT" line.  The limits are calibration settings. */
+
+#include <string.h>
+#include <rob_system.h>
+#include <rob_wrappers.h>
+#include <rob_comms.h>
+#include <rob_motion.h>
+#include <rob_calibration.h>
+#include <rob_current.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#define CURRENT_SAMPLE_PERIOD_MS 50
+#define CURRENT_AVERAGE_SAMPLES 4 /* So the moving average is over 200 ms */
+#define EVENT_STRING_LEN 32
+
+/* - GLOBALS -------------------------------------------------------------------------- */
+
+/* The samples in the moving average of each motor's current, and their sum */
+static unsigned char gCurrentSamples[CURRENT_NUM_MOTORS][CURRENT_AVERAGE_SAMPLES];
+static unsigned int gCurrentSum[CURRENT_NUM_MOTORS];
+
+static CurrentLog gCurrentLog;
+
+/* - STATIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* Empty the moving averages, e.g. once the motors have been braked, so that the
+ * current from before can't set off another fault */
+static void clearAverages (void)
+{
+    RobMemset (gCurrentSamples, 0, sizeof (gCurrentSamples));
+    RobMemset (gCurrentSum, 0, sizeof (gCurrentSum));
+}
+
+/* Tell the far end that a motor has faulted, e.g. "EVENT stall M1 150" */
+static void sendFaultEvent (const char * pFault, unsigned char motor, unsigned char current)
+{
+    char eventString[EVENT_STRING_LEN];
+
+    strcpy (eventString, "EVENT ");
+    strcat (eventString, pFault);
+    strcat (eventString, " M");
+    utoa (motor + 1, &eventString[RobStrlen (eventString)], 10);
+    strcat (eventString, " ");
+    utoa (current, &eventString[RobStrlen (eventString)], 10);
+    sendUnsolicitedString (eventString, RobStrlen (eventString) + 1);
+}
+
+/* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* The current monitor task */
+void vTaskCurrentMonitor (void *pvParameters)
+{
+    portTickType xWakeTime;
+    unsigned char currents[CURRENT_NUM_MOTORS];
+    unsigned int stallMs[CURRENT_NUM_MOTORS] = {0, 0};
+    unsigned char samplePos = 0;
+    unsigned char average;
+    unsigned int overcurrentLimit;
+    unsigned int stallLimit;
+    const char * pFault;
+    unsigned char x;
+
+    xWakeTime = xTaskGetTickCount();
+    while (1)
+    {
+        vTaskDelayUntil (&xWakeTime, CURRENT_SAMPLE_PERIOD_MS / portTICK_RATE_MS);
+
+        /* Both motors in one go, so that the speed loop waits on the SPI link once at most */
+        rob_x2_get_motor_currents (currents);
+
+        overcurrentLimit = getCalibration (CAL_OVERCURRENT);
+        stallLimit = getCalibration (CAL_STALL_CURRENT);
+        pFault = PNULL;
+        for (x = 0; (x < CURRENT_NUM_MOTORS) && (pFault == PNULL); x++)
+        {
+            gCurrentSum[x] -= gCurrentSamples[x][samplePos];
+            gCurrentSamples[x][samplePos] = currents[x];
+            gCurrentSum[x] += currents[x];
+            average = gCurrentSum[x] / CURRENT_AVERAGE_SAMPLES;
+
+            portENTER_CRITICAL();
+            {
+                gCurrentLog.average[x] = average;
+                if (average > gCurrentLog.maxAverage[x])
+                {
+                    gCurrentLog.maxAverage[x] = average;
+                }
+            }
+            portEXIT_CRITICAL();
+
+            if (average >= overcurrentLimit)
+            {
+                pFault = "overcurrent";
+                portENTER_CRITICAL();
+                {
+                    gCurrentLog.numOvercurrents++;
+                }
+                portEXIT_CRITICAL();
+            }
+            else
+            {
+                if (average >= stallLimit)
+                {
+                    stallMs[x] += CURRENT_SAMPLE_PERIOD_MS;
+                    if (stallMs[x] >= getCalibration (CAL_STALL_MS))
+                    {
+                        pFault = "stall";
+                        portENTER_CRITICAL();
+                        {
+                            gCurrentLog.numStalls++;
+                        }
+                        portEXIT_CRITICAL();
+                    }
+                }
+                else
+                {
+                    stallMs[x] = 0;
+                }
+            }
+
+            if (pFault != PNULL)
+            {
+                faultStop();
+                sendFaultEvent (pFault, x, average);
+                clearAverages();
+                RobMemset (stallMs, 0, sizeof (stallMs));
+            }
+        }
+
+        samplePos++;
+        if (samplePos >= CURRENT_AVERAGE_SAMPLES)
+        {
+            samplePos = 0;
+        }
+    }
+}
+
+/* Copy what the current monitor has seen into pLog */
+void getCurrentLog (CurrentLog * pLog)
+{
+    portENTER_CRITICAL();
+    {
+        *pLog = gCurrentLog;
+    }
+    portEXIT_CRITICAL();
+}
@@ -0,0 +1,23 @@
+/* Current - motor current monitoring part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+#define CURRENT_NUM_MOTORS 2 /* MOTOR1 and MOTOR2 */
+
+/* What the current monitor has seen since start of day, in the X2's current units */
+typedef struct CurrentLogTag
+{
+    unsigned char average[CURRENT_NUM_MOTORS];    /* The moving average now */
+    unsigned char maxAverage[CURRENT_NUM_MOTORS]; /* The highest it has been */
+    unsigned int numStalls;
+    unsigned int numOvercurrents;
+} CurrentLog;
+
+void vTaskCurrentMonitor (void *pvParameters);
+void getCurrentLog (CurrentLog * pLog);
\ No newline at end of file
@@ -0,0 +1,49 @@
+/* Distance - the distance sensor conversion part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+/* Kept apart from rob_sensor.c, with nothing but the table under it, so that the host
+ * build can check it, for every ADC code, against the curve the table comes from. */
+
+#include <rob_system.h>
+#include <rob_distance.h>
+#include <sharp_data.h>
+
+/* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* Convert a raw ADC code from a Sharp GP2Y0A41SK0F into a distance in mm, or 0 if
+ * there is nothing there (further than 40 cm).  The table, generated from the data
+ * sheet's curve, has an entry every few codes; in between it's a straight line,
+ * which is as close as the curve is known, so this takes the same time whatever
+ * the reading and needs neither millivolts nor a division.  Nearer than 3.5 cm the
+ * output falls again, so that's as near as it can tell. */
+unsigned int adcToDistanceMm (unsigned int code)
+{
+    unsigned char index;
+    unsigned char fraction;
+    unsigned int farMm;
+    unsigned int nearMm;
+
+    if (code < SHARP_DATA_FIRST_CODE)
+    {
+        return 0;
+    }
+    if (code >= SHARP_DATA_LAST_CODE)
+    {
+        return SHARP_DATA_MIN_MM;
+    }
+
+    code -= SHARP_DATA_FIRST_CODE;
+    index = code >> SHARP_DATA_STEP_SHIFT;
+    fraction = code & ((1 << SHARP_DATA_STEP_SHIFT) - 1);
+    farMm = pgm_read_word (&gSharpDataMm[index]);
+    nearMm = pgm_read_word (&gSharpDataMm[index + 1]);
+
+    return farMm - (((farMm - nearMm) * fraction + (1 << (SHARP_DATA_STEP_SHIFT - 1))) >> SHARP_DATA_STEP_SHIFT);
+}
@@ -0,0 +1,11 @@
+/* Distance - the distance sensor conversion part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+unsigned int adcToDistanceMm (unsigned int code);
\ No newline at end of file
@@ -33,7 +33,11 @@
 
 /* - GLOBALS -------------------------------------------------------------------------- */
 
-static HomeContext gHomeContext;
+static HomeContext gHomeContext;
+
+/* True from homing starting until it has stopped, failed or finished; the obstacle
+ * reflex stands down meanwhile since homing reverses right up to the charger */
+static volatile bool gHomeInProgress = false;
 
 /* - STATIC VARIABLES ----------------------------------------------------------------- */
 
@@ -97,6 +101,18 @@ void countIrDetector (int period10ms, unsigned int * pCountFront, unsigned int *
     }    
 }
 
+/* Note whether homing is under way; called by the homing states on entry */
+void setHomeInProgress (bool inProgress)
+{
+    gHomeInProgress = inProgress;
+}
+
+/* Whether homing is under way; any task may call this */
+bool isHomeInProgress (void)
+{
+    return gHomeInProgress;
+}
+
 /* The Homing task */
 void vTaskHome (void *pvParameters)
 {
@@ -121,7 +137,7 @@ void vTaskHome (void *pvParameters)
         {
             case HOME_START_EVENT:
             {
-                sendSerialString (OK_STRING, sizeof (OK_STRING));
+                sendSerialResponse (COMMS_RESPONSE_OK);
                 eventHomeStartOrangutan (&gHomeContext);
             }
             break;
@@ -180,7 +196,7 @@ void vTaskHome (void *pvParameters)
 
         if (!success)
         {
-            sendSerialString (ERROR_STRING, sizeof (ERROR_STRING));
+            sendSerialResponse (COMMS_RESPONSE_ERROR);
         }
     }
 }
\ No newline at end of file
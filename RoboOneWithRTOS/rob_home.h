@@ -33,4 +33,6 @@ typedef enum HomeEventTag
 /*
  * FUNCTION PROTOTYPES
  */
-void countIrDetector (int period10ms, unsigned int * pCountFront, unsigned int * pCountRight, unsigned int * pCountBack, unsigned int * pCountLeft);
\ No newline at end of file
+void countIrDetector (int period10ms, unsigned int * pCountFront, unsigned int * pCountRight, unsigned int * pCountBack, unsigned int * pCountLeft);
+void setHomeInProgress (bool inProgress);
+bool isHomeInProgress (void);
\ No newline at end of file
@@ -19,6 +19,7 @@
 #include <rob_home_state_stop.h>
 
 #include <rob_motion.h> /* For stopNow() */
+#include <rob_calibration.h>
 
 #include <FreeRTOS.h>
 #include <queue.h>
@@ -36,11 +37,6 @@
 /* The turn angle for one pulse */
 #define TURN_ANGLE_DEGREES 10
 
-/* The difference in count between left and right IR sensors 
- * (over the integration period) that we would like to
-*  achieve with fine alignment. */
-#define THRESHOLD_FINE_ALIGNMENT  10
-
 /* The maximum number of times we can go around
  * the fine alignment loop before declaring a failure */
 #define MAX_COUNT_FINE_ALIGNMENT 15
@@ -102,7 +98,7 @@ static void eventHomeFineIntegrationDone (HomeState *pState)
 
     leftMinusRight = gLeftCount - gRightCount;
     
-    if (abs (leftMinusRight) < THRESHOLD_FINE_ALIGNMENT)
+    if (abs (leftMinusRight) < (int) getCalibration (CAL_HOME_THRESHOLD_FINE_ALIGNMENT))
     {
         event = HOME_FINE_ALIGNMENT_DONE_EVENT;
     }
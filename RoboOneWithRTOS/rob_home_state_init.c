@@ -52,4 +52,5 @@ void transitionToHomeInit (HomeState *pState)
     pState->countRoughAlignmentEntries = 0;
     pState->countFineAlignmentEntries = 0;
     pState->countTravelEntries = 0;
+    setHomeInProgress (false);
 }
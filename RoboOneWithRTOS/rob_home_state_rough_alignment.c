@@ -19,6 +19,7 @@
 #include <rob_home_state_stop.h>
 
 #include <rob_motion.h> /* For stopNow() and turn() */
+#include <rob_calibration.h>
 
 #include <FreeRTOS.h>
 #include <queue.h>
@@ -37,11 +38,6 @@
  * can be considered to be the same. */
 #define SIMILARITY_TOLERANCE  10
 
-/* The difference in count between left and right IR sensors 
- * (over the integration period) that we would like to
- * achieve with rough alignment. */
-#define THRESHOLD_ROUGH_ALIGNMENT  30
-
 /* The maximum number of times we can go around
  * the rough alignment loop before declaring a failure */
 #define MAX_COUNT_ROUGH_ALIGNMENT 3
@@ -190,7 +186,7 @@ static void eventHomeRoughIntegrationDone (HomeState *pState)
     /* Check the results */
     if ((gFrontCount >= gLeftCount) &&
         (gFrontCount >= gRightCount) &&
-        (gFrontCount > THRESHOLD_ROUGH_ALIGNMENT))
+        (gFrontCount > getCalibration (CAL_HOME_THRESHOLD_ROUGH_ALIGNMENT)))
     {
         event = HOME_ROUGH_ALIGNMENT_DONE_EVENT;
     }
@@ -250,6 +246,7 @@ void transitionToHomeRoughAlignment (HomeState *pState)
     
     /* Do any entry actions */
     stopNow(); /* Just in case we were moving before */
+    setHomeInProgress (true);
     gRoughAlignmentCount = 0;    
     pState->countRoughAlignmentEntries++;
 
@@ -8,7 +8,6 @@
 #include <string.h>
 #include <rob_system.h>
 #include <rob_wrappers.h>
-#include <rob_motion.h>
 
 #include <rob_home.h>
 #include <rob_home_state_machine.h>
@@ -19,6 +18,7 @@
 #include <rob_home_state_stop.h>
 
 #include <rob_motion.h> /* For move() */
+#include <rob_calibration.h>
 
 #include <FreeRTOS.h>
 #include <queue.h>
@@ -39,11 +39,6 @@
  * during travel */
 #define INTEGRATION_PERIOD_TRAVEL_SECS 3
 
-/* The difference in count between left and right IR sensors 
- * (over the integration period) that we would like to
-*  achieve when travelling. */
-#define THRESHOLD_TRAVEL  10
-
 /* The maximum number of times we can re-align during
  * travel before declaring a failure */
 #define MAX_COUNT_TRAVEL_ALIGNMENT 50
@@ -111,7 +106,7 @@ static void eventHomeTravelIntegrationDone (HomeState *pState)
 
     ASSERT_PARAM (pState != PNULL, 0);
 
-    if (abs (gLeftCount - gRightCount) <= THRESHOLD_TRAVEL)
+    if (abs (gLeftCount - gRightCount) <= (int) getCalibration (CAL_HOME_THRESHOLD_TRAVEL))
     {
         if ((abs (gTweakLeft) < MAX_TWEAK) &&
             (abs (gTweakRight) < MAX_TWEAK))
@@ -0,0 +1,138 @@
+/* Latency - scheduling latency measurement part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+#include <rob_system.h>
+#include <rob_wrappers.h>
+#include <rob_latency.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#define LATENCY_PROBE_PERIOD_MS 5 /* How often the probe asks to be woken */
+
+/* - GLOBALS -------------------------------------------------------------------------- */
+
+/* Histogram of how late the probe task was woken: element x counts wake-ups that
+ * were x ms late, the last element counts everything later */
+static unsigned int gSchedulingLatencyHistogram[LATENCY_HISTOGRAM_SIZE];
+
+/* The latest that the probe task has ever been woken, in ms */
+static unsigned int gSchedulingLatencyMaxMs = 0;
+
+/* Histogram of the time from a stop command's terminator arriving to the brakes
+ * going on, and the longest it has taken */
+static unsigned int gStopLatencyHistogram[LATENCY_HISTOGRAM_SIZE];
+static unsigned int gStopLatencyMaxMs = 0;
+
+/* Histogram of the time from a distance sensor first seeing an obstacle in the way
+ * to the obstacle reflex putting the brakes on, and the longest it has taken */
+static unsigned int gReflexLatencyHistogram[LATENCY_HISTOGRAM_SIZE];
+static unsigned int gReflexLatencyMaxMs = 0;
+
+/* - STATIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* Add a latency to a histogram and its worst case; call from within a critical section */
+static void addToHistogram (unsigned int * pHistogram, unsigned int * pMaxMs, unsigned int latencyMs)
+{
+    if (latencyMs > *pMaxMs)
+    {
+        *pMaxMs = latencyMs;
+    }
+    if (latencyMs >= LATENCY_HISTOGRAM_SIZE)
+    {
+        latencyMs = LATENCY_HISTOGRAM_SIZE - 1;
+    }
+    pHistogram[latencyMs]++;
+}
+
+/* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* The latency probe task.  It runs above every task but the motion control task and
+ * asks to be woken at regular intervals; anything that holds it off beyond its wake-up
+ * tick (the scheduler being suspended, interrupts being off, the motion control task
+ * overrunning) shows up as lateness, which is what any other task that needs to run
+ * promptly would suffer too. */
+void vTaskLatencyProbe (void *pvParameters)
+{
+    portTickType xWakeTime;
+    unsigned int latencyMs;
+
+    xWakeTime = xTaskGetTickCount();
+    while (1)
+    {
+        vTaskDelayUntil (&xWakeTime, LATENCY_PROBE_PERIOD_MS / portTICK_RATE_MS);
+
+        latencyMs = (portTickType) (xTaskGetTickCount() - xWakeTime) * portTICK_RATE_MS;
+        portENTER_CRITICAL();
+        {
+            addToHistogram (gSchedulingLatencyHistogram, &gSchedulingLatencyMaxMs, latencyMs);
+        }
+        portEXIT_CRITICAL();
+
+        /* Don't try to catch up on wake-ups that were missed altogether */
+        xWakeTime = xTaskGetTickCount();
+    }
+}
+
+/* Copy the scheduling latency histogram into pHistogram, which must have room for
+ * LATENCY_HISTOGRAM_SIZE entries, and the worst case seen into pMaxMs */
+void getSchedulingLatency (unsigned int * pHistogram, unsigned int * pMaxMs)
+{
+    portENTER_CRITICAL();
+    {
+        RobMemcpy (pHistogram, gSchedulingLatencyHistogram, sizeof (gSchedulingLatencyHistogram));
+        *pMaxMs = gSchedulingLatencyMaxMs;
+    }
+    portEXIT_CRITICAL();
+}
+
+/* Note how long a stop took to take effect, in ms */
+void recordStopLatency (unsigned int latencyMs)
+{
+    portENTER_CRITICAL();
+    {
+        addToHistogram (gStopLatencyHistogram, &gStopLatencyMaxMs, latencyMs);
+    }
+    portEXIT_CRITICAL();
+}
+
+/* Copy the stop latency histogram into pHistogram, which must have room for
+ * LATENCY_HISTOGRAM_SIZE entries, and the worst case seen into pMaxMs */
+void getStopLatency (unsigned int * pHistogram, unsigned int * pMaxMs)
+{
+    portENTER_CRITICAL();
+    {
+        RobMemcpy (pHistogram, gStopLatencyHistogram, sizeof (gStopLatencyHistogram));
+        *pMaxMs = gStopLatencyMaxMs;
+    }
+    portEXIT_CRITICAL();
+}
+
+/* Note how long the obstacle reflex took to brake, in ms */
+void recordReflexLatency (unsigned int latencyMs)
+{
+    portENTER_CRITICAL();
+    {
+        addToHistogram (gReflexLatencyHistogram, &gReflexLatencyMaxMs, latencyMs);
+    }
+    portEXIT_CRITICAL();
+}
+
+/* Copy the obstacle reflex latency histogram into pHistogram, which must have room for
+ * LATENCY_HISTOGRAM_SIZE entries, and the worst case seen into pMaxMs */
+void getReflexLatency (unsigned int * pHistogram, unsigned int * pMaxMs)
+{
+    portENTER_CRITICAL();
+    {
+        RobMemcpy (pHistogram, gReflexLatencyHistogram, sizeof (gReflexLatencyHistogram));
+        *pMaxMs = gReflexLatencyMaxMs;
+    }
+    portEXIT_CRITICAL();
+}
@@ -0,0 +1,23 @@
+/* Latency - scheduling latency measurement part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+#define LATENCY_HISTOGRAM_SIZE 11 /* 0 to 9 ms and 10 ms or more */
+
+void vTaskLatencyProbe (void *pvParameters);
+
+void getSchedulingLatency (unsigned int * pHistogram, unsigned int * pMaxMs);
+
+void recordStopLatency (unsigned int latencyMs);
+
+void getStopLatency (unsigned int * pHistogram, unsigned int * pMaxMs);
+
+void recordReflexLatency (unsigned int latencyMs);
+
+void getReflexLatency (unsigned int * pHistogram, unsigned int * pMaxMs);
\ No newline at end of file
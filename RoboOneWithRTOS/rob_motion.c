@@ -13,6 +13,10 @@
 #include <rob_processing.h>
 #include <rob_comms.h>
 #include <rob_motion.h>
+#include <rob_odometry.h>
+#include <rob_latency.h>
+#include <rob_calibration.h>
+#include <speed_data.h>
 
 #include <rob_home_state_machine.h>
 #include <rob_home_state_machine_events.h>
@@ -21,14 +25,48 @@
 #include <FreeRTOS.h>
 #include <task.h>
 #include <queue.h>
+#include <semphr.h>
 #include <pololu/orangutan.h>
 
 #define MAX_SPEED_O_UNITS 255
-#define METRES_TO_TIME_FACTOR 7
-#define CM_S_TO_O_UNITS_FACTOR 3
-#define MOTOR1_TO_MOTOR2_OFFSET 5 /* Positive if MOTOR2 (right) is weaker than MOTOR1 (left) */
-#define TURN_SPEED_O_UNITS 80
-#define TIME_PER_DEGREE_10MS 2 /* TODO: calibrate this */
+#define MOVE_TIMEOUT_MARGIN_MS 1000 /* On top of twice the time a move should take */
+#define MOTION_STEP_MS 5 /* How often the motion task checks on a motion in progress */
+#define TURN_TIMEOUT_MS 5000 /* Give up on a turn that's got stuck */
+#define TURN_POLL_MS 10 /* How often a task waiting for a turn looks up */
+
+/* The speed loop; its gains, and those of the motion profile, are calibration settings */
+#define MOTION_CONTROL_PERIOD_MS 20
+
+/* A distance beyond any that the speed data was measured over, for runs with no end in sight */
+#define SPEED_DATA_DISTANCE_UNLIMITED 0xFFFF
+
+/* Wheel encoder pins, channel A then B.  On the X2 the whole of port C is the LCD's
+ * data bus, port B carries the LCD's control lines (PB0, PB1, PB3) and the SPI link to
+ * the auxiliary processor (PB4 to PB7), port A the distance sensors, the battery divider
+ * and the trimpot and PD0 to PD4 the home IR detectors: PD5 to PD7 and PB2 are what is
+ * left, and the pin-change interrupts the encoder library uses work on any of them */
+#define ENCODER_LEFT_A_PIN IO_D7
+#define ENCODER_LEFT_B_PIN IO_B2
+#define ENCODER_RIGHT_A_PIN IO_D5
+#define ENCODER_RIGHT_B_PIN IO_D6
+
+/* The speed loop's state for one wheel; distances are in 1/256ths of an encoder count */
+typedef struct WheelControlTag
+{
+    unsigned char motor;
+    long lagQ8;          /* How far behind where it should be the wheel is, clamped */
+    long runLagQ8;       /* The same since the run began, unclamped, for the log */
+    unsigned long runMaxLagQ8;
+    int driveOUnits;     /* What the motor was last told */
+} WheelControl;
+
+/* What the motion task is in the middle of doing */
+typedef enum MotionStateTag
+{
+    MOTION_STATE_IDLE = 0,
+    MOTION_STATE_MOVING_DISTANCE,
+    MOTION_STATE_TURNING
+} MotionState;
 
 /* - GLOBALS -------------------------------------------------------------------------- */
 
@@ -37,6 +75,46 @@ static int gLastSpeedOUnits = 0;
 static int gLastTweakLeft = 0;
 static int gLastTweakRight = 0;
 
+/* Speeds the speed loop is to achieve, set by the motion task, plus a count of the
+ * times they've been set so that the loop can tell if its reading has gone stale */
+static int gTargetMmS[NUM_WHEELS];
+static volatile unsigned char gTargetGeneration = 0;
+static bool gStartRun = false;
+
+/* How much harder or softer than nominal the motors need driving to make those
+ * speeds over the run they're part of, in hundredths, from the speed data */
+static unsigned char gDriveFactorX100 = 100;
+
+/* Owned by the speed loop (MOTOR1 drives the left wheel) */
+static WheelControl gWheelControl[NUM_WHEELS] = {{MOTOR1, 0, 0, 0, 0}, {MOTOR2, 0, 0, 0, 0}};
+static bool gWheelsBraked = true;
+
+/* A goal, a distance to go in a straight line or an angle to turn on the spot, set
+ * up by startGoal() and ended by the speed loop when the wheels have gone far enough
+ * (or it's taken too long), or by anyone setting new targets.  Goals are numbered so
+ * that a task waiting for one can tell if it's the one that's ended. */
+static bool gGoalActive = false;
+static bool gGoalForwards[NUM_WHEELS];
+static long gGoalRemainingQ8 = 0; /* Between the two wheels, each counting the way it's going */
+static unsigned int gGoalPeriodsLeft = 0;
+static unsigned char gGoalNumber = 0;
+static unsigned char gGoalDoneNumber = 0;
+static bool gGoalDoneCompleted = false;
+static xSemaphoreHandle xGoalDoneSemaphore;
+
+/* The run log, written by the speed loop, read by anyone */
+static MotionControlLog gMotionControlLog;
+
+/* The motion the motion task has under way, owned by the motion task: a command
+ * that takes a while is started and then checked on between commands, so that
+ * the next command (e.g. a stop) can take over at once */
+static MotionState gMotionState = MOTION_STATE_IDLE;
+static unsigned char gMotionGoalNumber = 0;
+
+/* Set by faultStop(), from whichever task saw the fault, for the motion task to
+ * clear up after */
+static volatile bool gFaultStopPending = false;
+
 /* - STATIC FUNCTIONS ----------------------------------------------------------------- */
 
 /* Convert the two byte value field into an int */
@@ -49,46 +127,485 @@ static int convertValueToInt (unsigned char *pValueArray)
     return value;
 }
 
-/* Offset the motor speed of motor1 to balance things out */
-static int motor1Speed (int speed)
+/* Keep a motor drive within what the motors will take */
+static int limitOUnits (long speedOUnits)
 {
-    if (speed >= 0)
+    if (speedOUnits > MAX_SPEED_O_UNITS)
+    {
+        speedOUnits = MAX_SPEED_O_UNITS;
+    }
+    else
     {
-        if (speed <= MAX_SPEED_O_UNITS - MOTOR1_TO_MOTOR2_OFFSET)
+        if (speedOUnits < -MAX_SPEED_O_UNITS)
         {
-            speed += MOTOR1_TO_MOTOR2_OFFSET;
+            speedOUnits = -MAX_SPEED_O_UNITS;
         }
     }
-    else
+
+    return (int) speedOUnits;
+}
+
+/* Convert a speed in mm/s into 1/256ths of an encoder count per control period */
+static long mmSToCountsQ8 (long speedMmS)
+{
+    return (speedMmS * WHEEL_COUNTS_PER_REV * 256 * MOTION_CONTROL_PERIOD_MS) / (getCalibration (CAL_WHEEL_CIRCUMFERENCE_MM) * 1000L);
+}
+
+/* Convert 1/256ths of an encoder count into mm */
+static long countsQ8ToMm (long distanceQ8)
+{
+    return (distanceQ8 * getCalibration (CAL_WHEEL_CIRCUMFERENCE_MM)) / (WHEEL_COUNTS_PER_REV * 256L);
+}
+
+/* Difference between the right and left wheel encoders, in 1/256ths of a count, for
+ * each degree turned on the spot; 355/113 is pi */
+static long turnCountsQ8PerDegree (void)
+{
+    return (355L * WHEEL_COUNTS_PER_REV * 256 * getCalibration (CAL_WHEEL_BASE_MM)) / (113L * 180 * getCalibration (CAL_WHEEL_CIRCUMFERENCE_MM));
+}
+
+/* Find where value falls along an axis of the speed data (a PROGMEM table of size
+ * ascending values): returns the index of the entry at or below it, with how far
+ * on it is towards the next entry in *pFraction, in 256ths; off either end the
+ * end entry is as far as it goes */
+static unsigned char speedDataPosition (const unsigned int * pAxis, unsigned char size, unsigned int value, unsigned int * pFraction)
+{
+    unsigned char index = 0;
+    unsigned int low;
+    unsigned int high;
+
+    *pFraction = 0;
+    while (index < size - 1 && value >= pgm_read_word (&pAxis[index + 1]))
     {
-        if (speed >= -MAX_SPEED_O_UNITS + MOTOR1_TO_MOTOR2_OFFSET)
+        index++;
+    }
+    low = pgm_read_word (&pAxis[index]);
+    if (index < size - 1 && value > low)
+    {
+        high = pgm_read_word (&pAxis[index + 1]);
+        *pFraction = (unsigned int) ((((unsigned long) (value - low)) << 8) / (high - low));
+    }
+
+    return index;
+}
+
+/* The speed data's factor for a run at speedMmS over distanceCm, interpolated
+ * between the speeds and distances it was measured at */
+static unsigned char speedDataFactorX100 (int speedMmS, unsigned int distanceCm)
+{
+    unsigned char speedIndex;
+    unsigned char distanceIndex;
+    unsigned char nextSpeedIndex;
+    unsigned char nextDistanceIndex;
+    unsigned int speedFraction;
+    unsigned int distanceFraction;
+    int slower;
+    int faster;
+
+    if (speedMmS < 0)
+    {
+        speedMmS = -speedMmS;
+    }
+    speedIndex = speedDataPosition (gSpeedDataSpeeds, SPEED_DATA_NUM_SPEEDS, (unsigned int) (((long) speedMmS * CM_S_TO_O_UNITS_FACTOR) / 10), &speedFraction);
+    distanceIndex = speedDataPosition (gSpeedDataDistances, SPEED_DATA_NUM_DISTANCES, distanceCm, &distanceFraction);
+    nextSpeedIndex = speedFraction > 0 ? speedIndex + 1 : speedIndex;
+    nextDistanceIndex = distanceFraction > 0 ? distanceIndex + 1 : distanceIndex;
+
+    /* Along the distances at the speeds either side, then between those */
+    slower = pgm_read_byte (&gSpeedDataFactors[speedIndex][distanceIndex]);
+    slower += (((int) pgm_read_byte (&gSpeedDataFactors[speedIndex][nextDistanceIndex]) - slower) * (int) distanceFraction) >> 8;
+    faster = pgm_read_byte (&gSpeedDataFactors[nextSpeedIndex][distanceIndex]);
+    faster += (((int) pgm_read_byte (&gSpeedDataFactors[nextSpeedIndex][nextDistanceIndex]) - faster) * (int) distanceFraction) >> 8;
+
+    return (unsigned char) (slower + (((faster - slower) * (int) speedFraction) >> 8));
+}
+
+/* The speed data's factor for wheels going at leftMmS and rightMmS over distanceCm */
+static unsigned char driveFactorX100 (int leftMmS, int rightMmS, unsigned int distanceCm)
+{
+    if (leftMmS < 0)
+    {
+        leftMmS = -leftMmS;
+    }
+    if (rightMmS < 0)
+    {
+        rightMmS = -rightMmS;
+    }
+
+    return speedDataFactorX100 (leftMmS > rightMmS ? leftMmS : rightMmS, distanceCm);
+}
+
+/* Mark the goal in progress as over; call from within a critical section */
+static void endGoal (bool completed)
+{
+    gGoalActive = false;
+    gGoalDoneNumber = gGoalNumber;
+    gGoalDoneCompleted = completed;
+}
+
+/* Give the speed loop new speeds to achieve, cancelling any goal in progress */
+static void setWheelTargets (int leftMmS, int rightMmS)
+{
+    bool cancelledGoal;
+    unsigned char factorX100 = driveFactorX100 (leftMmS, rightMmS, SPEED_DATA_DISTANCE_UNLIMITED);
+
+    portENTER_CRITICAL();
+    {
+        cancelledGoal = gGoalActive;
+        if (gGoalActive)
+        {
+            endGoal (false);
+        }
+        if (gTargetMmS[WHEEL_LEFT] == 0 && gTargetMmS[WHEEL_RIGHT] == 0)
+        {
+            gStartRun = true;
+        }
+        gTargetMmS[WHEEL_LEFT] = leftMmS;
+        gTargetMmS[WHEEL_RIGHT] = rightMmS;
+        gDriveFactorX100 = factorX100;
+        gTargetGeneration++;
+    }
+    portEXIT_CRITICAL();
+
+    if (cancelledGoal)
+    {
+        xSemaphoreGive (xGoalDoneSemaphore);
+    }
+}
+
+/* Drive the wheels at speeds in (nominal) O units, the speed loop making good
+ * whatever the motors actually manage at that drive */
+static void driveWheels (int leftOUnits, int rightOUnits)
+{
+    setWheelTargets ((limitOUnits (leftOUnits) * 10) / CM_S_TO_O_UNITS_FACTOR, (limitOUnits (rightOUnits) * 10) / CM_S_TO_O_UNITS_FACTOR);
+}
+
+/* Stop the wheels dead, now rather than at the speed loop's next period */
+static void brakeWheels (void)
+{
+    setWheelTargets (0, 0);
+    rob_x2_set_motors (BRAKE_LOW, 0, BRAKE_LOW, 0);
+}
+
+/* Set both wheels' motors in one go, so that a change of speed hits both wheels
+ * together rather than yawing the robot for however long lies between two writes */
+static void setWheelDrives (unsigned char operation, const int * pDriveOUnits)
+{
+    int motorOUnits[NUM_WHEELS];
+    unsigned char x;
+
+    for (x = 0; x < NUM_WHEELS; x++)
+    {
+        motorOUnits[gWheelControl[x].motor] = pDriveOUnits[x];
+    }
+    rob_x2_set_motors (operation, motorOUnits[MOTOR1], operation, motorOUnits[MOTOR2]);
+}
+
+/* How many speed loop periods a goal with remainingQ8 to go should be given at
+ * speedMmS before it's reckoned to have got stuck */
+static unsigned int goalTimeoutPeriods (long remainingQ8, int speedMmS)
+{
+    long timeMs;
+
+    timeMs = (countsQ8ToMm (remainingQ8 / 2) * 2 * 1000L) / speedMmS + MOVE_TIMEOUT_MARGIN_MS;
+
+    return (unsigned int) (timeMs / MOTION_CONTROL_PERIOD_MS);
+}
+
+/* Start the wheels off towards a goal at top speeds leftMmS and rightMmS, the speed
+ * loop profiling the speed and ending the goal once the wheels have gone distanceQ8
+ * between them, each counting the way it is going, or after timeoutPeriods.  Cancels
+ * any goal in progress.  Returns the number of the goal, for waitGoal(). */
+static unsigned char startGoal (int leftMmS, int rightMmS, long distanceQ8, unsigned int timeoutPeriods, unsigned char factorX100)
+{
+    unsigned char goalNumber;
+    bool cancelledGoal;
+
+    portENTER_CRITICAL();
+    {
+        cancelledGoal = gGoalActive;
+        if (gGoalActive)
+        {
+            endGoal (false);
+        }
+        gGoalNumber++;
+        goalNumber = gGoalNumber;
+        if (distanceQ8 > 0)
+        {
+            if (gTargetMmS[WHEEL_LEFT] == 0 && gTargetMmS[WHEEL_RIGHT] == 0)
+            {
+                gStartRun = true;
+            }
+            gGoalActive = true;
+            gGoalForwards[WHEEL_LEFT] = (leftMmS >= 0);
+            gGoalForwards[WHEEL_RIGHT] = (rightMmS >= 0);
+            gGoalRemainingQ8 = distanceQ8;
+            gGoalPeriodsLeft = timeoutPeriods;
+            gTargetMmS[WHEEL_LEFT] = leftMmS;
+            gTargetMmS[WHEEL_RIGHT] = rightMmS;
+            gDriveFactorX100 = factorX100;
+            gTargetGeneration++;
+        }
+        else
+        {
+            endGoal (true);
+        }
+    }
+    portEXIT_CRITICAL();
+
+    if (cancelledGoal)
+    {
+        xSemaphoreGive (xGoalDoneSemaphore);
+    }
+
+    return goalNumber;
+}
+
+/* Start turning on the spot, stopping first.  Returns the number of the goal. */
+static unsigned char startTurn (int degrees)
+{
+    int speedMmS = (getCalibration (CAL_TURN_SPEED_O_UNITS) * 10) / CM_S_TO_O_UNITS_FACTOR;
+
+    /* Make it a positive number and max 359 degrees */
+    degrees = (degrees + 360) % 360;
+
+    /* Turn the other way if it's more than 180 degrees */
+    if (degrees > 180)
+    {
+        speedMmS = -speedMmS;
+        degrees = 360 - degrees;
+    }
+
+    brakeWheels();
+
+    /* The speed data was measured going in a straight line, so it's no guide here */
+    return startGoal (-speedMmS, speedMmS, degrees * turnCountsQ8PerDegree(), TURN_TIMEOUT_MS / MOTION_CONTROL_PERIOD_MS, 100);
+}
+
+/* Start moving distanceMm in a straight line at speedMmS, backwards if that's
+ * negative, from whatever the wheels are doing now.  Returns the number of the goal. */
+static unsigned char startDistance (long distanceMm, int speedMmS)
+{
+    long distanceQ8;
+
+    /* Each wheel goes the whole distance */
+    distanceQ8 = ((distanceMm * 256 * 2) / getCalibration (CAL_WHEEL_CIRCUMFERENCE_MM)) * WHEEL_COUNTS_PER_REV;
+
+    return startGoal (speedMmS, speedMmS, distanceQ8, goalTimeoutPeriods (distanceQ8, speedMmS >= 0 ? speedMmS : -speedMmS), speedDataFactorX100 (speedMmS, (unsigned int) (distanceMm / 10)));
+}
+
+/* Change the top speed of the goal in progress, if there is one, without cancelling it.
+ * The timeout and the drive factor are worked out from how far the goal had to go a
+ * moment before, outside the critical section, since that much arithmetic would keep
+ * interrupts off for too long; the goal won't have gone far in the meantime. */
+static bool setGoalSpeed (int speedMmS)
+{
+    bool goalActive;
+    unsigned char goalNumber;
+    long remainingQ8;
+    bool straight;
+    unsigned int timeoutPeriods;
+    unsigned char factorX100 = 0;
+    unsigned char x;
+
+    portENTER_CRITICAL();
+    {
+        goalActive = gGoalActive;
+        goalNumber = gGoalNumber;
+        remainingQ8 = gGoalRemainingQ8;
+        straight = (gGoalForwards[WHEEL_LEFT] == gGoalForwards[WHEEL_RIGHT]);
+    }
+    portEXIT_CRITICAL();
+
+    if (!goalActive)
+    {
+        return false;
+    }
+
+    timeoutPeriods = goalTimeoutPeriods (remainingQ8, speedMmS);
+    if (straight)
+    {
+        factorX100 = speedDataFactorX100 (speedMmS, (unsigned int) (countsQ8ToMm (remainingQ8 / 2) / 10));
+    }
+
+    portENTER_CRITICAL();
+    {
+        /* It may have ended, or been replaced, while the sums were being done */
+        goalActive = gGoalActive && (gGoalNumber == goalNumber);
+        if (goalActive)
         {
-            speed -= MOTOR1_TO_MOTOR2_OFFSET;
+            for (x = 0; x < NUM_WHEELS; x++)
+            {
+                gTargetMmS[x] = gGoalForwards[x] ? speedMmS : -speedMmS;
+            }
+            gGoalPeriodsLeft = timeoutPeriods;
+            if (straight)
+            {
+                gDriveFactorX100 = factorX100;
+            }
+            gTargetGeneration++;
         }
     }
+    portEXIT_CRITICAL();
+
+    return goalActive;
+}
+
+/* Wait up to xTicksToWait for goal goalNumber to end.  Returns true if it has, with
+ * *pCompleted set if it got all the way there rather than being cancelled. */
+static bool waitGoal (unsigned char goalNumber, portTickType xTicksToWait, bool * pCompleted)
+{
+    bool ended;
+
+    xSemaphoreTake (xGoalDoneSemaphore, xTicksToWait);
+
+    portENTER_CRITICAL();
+    {
+        /* A later goal having ended means this one has too */
+        ended = ((signed char) (gGoalDoneNumber - goalNumber) >= 0);
+        *pCompleted = (gGoalDoneNumber == goalNumber) && gGoalDoneCompleted;
+    }
+    portEXIT_CRITICAL();
+
+    return ended;
+}
+
+/* Carry on moving after a turn if we were before it */
+static void resumeAfterTurn (void)
+{
+    if (gLastSpeedOUnits > 0)
+    {
+        driveWheels (gLastSpeedOUnits + gLastTweakLeft, gLastSpeedOUnits + gLastTweakRight);
+    }
+    else
+    {
+        brakeWheels();
+    }
+}
+
+/* Integer square root, rounded down */
+static unsigned int squareRoot (unsigned long value)
+{
+    unsigned long root = 0;
+    unsigned long bit = 1UL << 30;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (unsigned int) root;
+}
+
+/* Move a wheel's setpoint towards its target no faster than the profile's
+ * acceleration allows over elapsedMs */
+static int slewMmS (int setpointMmS, int targetMmS, unsigned int elapsedMs)
+{
+    int stepMmS = (int) (((long) getCalibration (CAL_PROFILE_ACCEL_MM_S2) * elapsedMs) / 1000);
+
+    if (targetMmS > setpointMmS + stepMmS)
+    {
+        return setpointMmS + stepMmS;
+    }
+    if (targetMmS < setpointMmS - stepMmS)
+    {
+        return setpointMmS - stepMmS;
+    }
+
+    return targetMmS;
+}
+
+/* The fastest a wheel can be going with remainingQ8 of a goal to go (between the two
+ * wheels) and still slow down at the profile's acceleration to arrive, though never
+ * so slow that it wouldn't get there at all */
+static int profileLimitMmS (long remainingQ8)
+{
+    long remainingMm = countsQ8ToMm (remainingQ8 / 2);
+    unsigned int minimumMmS = getCalibration (CAL_PROFILE_MIN_SPEED_MM_S);
+    unsigned int limitMmS = 0;
 
-    return speed;
+    if (remainingMm > 0)
+    {
+        limitMmS = squareRoot (2UL * getCalibration (CAL_PROFILE_ACCEL_MM_S2) * remainingMm);
+    }
+    if (limitMmS < minimumMmS)
+    {
+        limitMmS = minimumMmS;
+    }
+
+    return (int) limitMmS;
+}
+
+/* The drive that the open loop would have used for a speed, corrected by the
+ * speed data's factor for the run */
+static int feedForwardOUnits (int targetMmS, unsigned char factorX100)
+{
+    return limitOUnits (((long) targetMmS * CM_S_TO_O_UNITS_FACTOR * factorX100) / (10 * 100));
 }
 
-/* Offset the motor speed of motor2 to balance things out */
-static int motor2Speed (int speed)
+/* One period of the speed loop for a wheel that has turned counts in the elapsedMs
+ * since the last; returns the drive for its motor.  The integral term is the
+ * distance the wheel has fallen behind, which the encoder counts exactly, so it
+ * takes out the quantisation that dominates the speed measured over one period. */
+static int speedLoop (WheelControl * pWheel, int targetMmS, unsigned char factorX100, int counts, unsigned int elapsedMs)
 {
-    if (speed >= 0)
+    long errorQ8;
+    long driveOUnits;
+    unsigned long lagQ8;
+    unsigned int kpX16 = getCalibration (CAL_SPEED_LOOP_KP_X16);
+    unsigned int kiX16 = getCalibration (CAL_SPEED_LOOP_KI_X16);
+    long lagLimitQ8 = ((long) MAX_SPEED_O_UNITS * 16 * 256) / kiX16;
+
+    /* How far the wheel should have gone less how far it went */
+    errorQ8 = (mmSToCountsQ8 (targetMmS) * elapsedMs) / MOTION_CONTROL_PERIOD_MS - ((long) counts << 8);
+
+    /* Don't wind up while the motor is flat out */
+    if (!((pWheel->driveOUnits >= MAX_SPEED_O_UNITS && errorQ8 > 0) || (pWheel->driveOUnits <= -MAX_SPEED_O_UNITS && errorQ8 < 0)))
     {
-        if (speed > MAX_SPEED_O_UNITS - MOTOR1_TO_MOTOR2_OFFSET)
+        pWheel->lagQ8 += errorQ8;
+        if (pWheel->lagQ8 > lagLimitQ8)
+        {
+            pWheel->lagQ8 = lagLimitQ8;
+        }
+        else
         {
-            speed -= MOTOR1_TO_MOTOR2_OFFSET;
+            if (pWheel->lagQ8 < -lagLimitQ8)
+            {
+                pWheel->lagQ8 = -lagLimitQ8;
+            }
         }
     }
-    else
+
+    /* Feed forward what the open loop would have used, then correct for the speed
+     * error (scaled to a nominal period) and the distance error */
+    driveOUnits = feedForwardOUnits (targetMmS, factorX100);
+    driveOUnits += (((errorQ8 * MOTION_CONTROL_PERIOD_MS) / elapsedMs) * (long) kpX16 + pWheel->lagQ8 * (long) kiX16) / (16 * 256);
+
+    portENTER_CRITICAL();
     {
-        if (speed < -MAX_SPEED_O_UNITS + MOTOR1_TO_MOTOR2_OFFSET)
+        pWheel->runLagQ8 += errorQ8;
+        lagQ8 = pWheel->runLagQ8 >= 0 ? pWheel->runLagQ8 : -pWheel->runLagQ8;
+        if (lagQ8 > pWheel->runMaxLagQ8)
         {
-            speed += MOTOR1_TO_MOTOR2_OFFSET;
+            pWheel->runMaxLagQ8 = lagQ8;
         }
     }
+    portEXIT_CRITICAL();
 
-    return speed;
+    return limitOUnits (driveOUnits);
 }
 
 /* Set speed (forward or backward) */
@@ -121,37 +638,94 @@ static bool setSpeed (unsigned int speedCmS)
     return true;
 }
 
-/* Move forwards or backwards a given distance */
-static bool moveDistance (unsigned int distanceM, bool isForwards)
+/* Start moving forwards or backwards a given distance; the speed loop
+ * takes it from there and stepMotion() sees when it's got there */
+static bool startMoveDistance (unsigned int distanceCm, bool isForwards)
+{
+    if (gSetSpeedOUnits <= 0)
+    {
+        return false;
+    }
+
+    gLastSpeedOUnits = gSetSpeedOUnits;
+    if (!isForwards)
+    {
+        gLastSpeedOUnits = -gLastSpeedOUnits;
+    }
+
+    rob_print_unsigned_long (distanceCm);
+    rob_print_from_program_space (PSTR (" cm @"));
+    rob_print_long (gLastSpeedOUnits / CM_S_TO_O_UNITS_FACTOR);
+    rob_print_from_program_space (PSTR (" cm/s"));
+    rob_print_from_program_space (PSTR (" ("));
+    rob_print_long (gLastSpeedOUnits);
+    rob_print_from_program_space (PSTR (" )"));
+
+    gMotionGoalNumber = startDistance ((long) distanceCm * 10, (gLastSpeedOUnits * 10) / CM_S_TO_O_UNITS_FACTOR);
+
+    return true;
+}
+
+/* Carry on with the move in progress at the speed that's just been set */
+static bool changeMoveSpeed (void)
+{
+    if (gSetSpeedOUnits <= 0)
+    {
+        return false;
+    }
+
+    gLastSpeedOUnits = gLastSpeedOUnits >= 0 ? gSetSpeedOUnits : -gSetSpeedOUnits;
+
+    return setGoalSpeed ((gSetSpeedOUnits * 10) / CM_S_TO_O_UNITS_FACTOR);
+}
+
+/* Check on the motion in progress, if there is one.  Returns true if it has just
+ * finished, with *pSuccess saying whether it did what it was meant to. */
+static bool stepMotion (bool * pSuccess)
 {
-    int time10ms;
-
-    gLastSpeedOUnits = gSetSpeedOUnits;
-    time10ms = (distanceM / gLastSpeedOUnits) * 100 * METRES_TO_TIME_FACTOR;
+    bool finished = false;
 
-    if (!isForwards)
+    switch (gMotionState)
     {
-        gLastSpeedOUnits = -gLastSpeedOUnits;
+        case MOTION_STATE_MOVING_DISTANCE:
+        {
+            finished = waitGoal (gMotionGoalNumber, 0, pSuccess);
+            if (finished && *pSuccess)
+            {
+                stopNow();
+            }
+        }
+        break;
+        case MOTION_STATE_TURNING:
+        {
+            finished = waitGoal (gMotionGoalNumber, 0, pSuccess);
+            if (finished && *pSuccess)
+            {
+                resumeAfterTurn();
+            }
+        }
+        break;
+        default:
+        break;
     }
 
-    rob_print_from_program_space (PSTR ("~"));
-    rob_print_long (time10ms / 100);
-    rob_print_from_program_space (PSTR (" s @"));
-    rob_print_long (gLastSpeedOUnits / CM_S_TO_O_UNITS_FACTOR);
-    rob_print_from_program_space (PSTR (" cm/s"));
-    rob_print_from_program_space (PSTR (" ("));
-    rob_print_long (gLastSpeedOUnits);
-    rob_print_from_program_space (PSTR (" )"));
-
-    /* TODO fix this (1's and 2's swapped) */
-    x2_set_motor (MOTOR1, ACCEL_DRIVE, motor2Speed (gLastSpeedOUnits));
-    x2_set_motor (MOTOR2, ACCEL_DRIVE, motor1Speed (gLastSpeedOUnits));
-
-    vTaskDelay (time10ms / portTICK_RATE_MS);
+    if (finished)
+    {
+        gMotionState = MOTION_STATE_IDLE;
+    }
 
-    stopNow();
+    return finished;
+}
 
-    return true;
+/* Give up on the motion in progress, if there is one, since a new command has
+ * taken over; it never got to finish, so its command failed */
+static void preemptMotion (void)
+{
+    if (gMotionState != MOTION_STATE_IDLE)
+    {
+        gMotionState = MOTION_STATE_IDLE;
+        sendSerialResponse (COMMS_RESPONSE_ERROR);
+    }
 }
 
 /* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
@@ -174,9 +748,7 @@ bool move (int speedOUnits, int tweakLeft, int tweakRight)
     rob_print_long (tweakRight);
     rob_print_from_program_space (PSTR ("R"));
 
-    /* TODO fix this (1's and 2's swapped) */
-    x2_set_motor (MOTOR1, ACCEL_DRIVE, motor2Speed (gLastSpeedOUnits + gLastTweakLeft));
-    x2_set_motor (MOTOR2, ACCEL_DRIVE, motor1Speed (gLastSpeedOUnits + gLastTweakRight));
+    driveWheels (gLastSpeedOUnits + gLastTweakLeft, gLastSpeedOUnits + gLastTweakRight);
 
     return true;
 }
@@ -189,76 +761,408 @@ bool stopNow (void)
     gLastTweakRight = 0;
     
     rob_print_from_program_space (PSTR ("STOP."));
-    x2_set_motor (MOTOR1, BRAKE_LOW, 0);
-    x2_set_motor (MOTOR2, BRAKE_LOW, 0);
+    brakeWheels();
 
     return true;
 }
 
-/* Turn (left or right), stopping first and resuming previous movement afterwards */
+/* Turn (left or right), stopping first and resuming previous movement afterwards.
+ * Returns when the turn is over: false if it was cancelled part way round. */
 bool turn (int degrees)
 {
-    int turnSpeed = TURN_SPEED_O_UNITS;
-    
+    unsigned char turnNumber;
+    bool completed = false;
+
     rob_print_long (degrees);
     rob_print_from_program_space (PSTR (" TURN."));
 
-    x2_set_motor (MOTOR1, BRAKE_LOW, 0);
-    x2_set_motor (MOTOR2, BRAKE_LOW, 0);
-    
-    /* Make it a positive number and max 359 degrees */
-    degrees = (degrees + 360) % 360;
-    
-    /* Turn the other way if it's more than 180 degrees */
-    if (turnSpeed > 180)
+    turnNumber = startTurn (degrees);
+    while (!waitGoal (turnNumber, TURN_POLL_MS / portTICK_RATE_MS, &completed))
     {
-        turnSpeed = -turnSpeed;
-        degrees = 360 - degrees;
     }
-    
-    /* TODO fix this (1's and 2's swapped) */
-    x2_set_motor (MOTOR1, ACCEL_DRIVE, motor2Speed (-turnSpeed));
-    x2_set_motor (MOTOR2, ACCEL_DRIVE, motor1Speed (turnSpeed));
-    
-    /* Wait for a while, depending on the number of degrees */
-    vTaskDelay ((TIME_PER_DEGREE_10MS * degrees) / portTICK_RATE_MS);
 
-    if (gLastSpeedOUnits > 0)
+    resumeAfterTurn();
+
+    return completed;
+}
+
+/* One-time initialisation */
+void motionInit (void)
+{
+    vSemaphoreCreateBinary (xGoalDoneSemaphore);
+    ASSERT_STRING (xGoalDoneSemaphore, "Could not create xGoalDoneSemaphore");
+    xSemaphoreTake (xGoalDoneSemaphore, 0); /* Binary semaphores are created "given" */
+}
+
+/* Copy the speed loop's log of the current (or last) run into pLog */
+void getMotionControlLog (MotionControlLog * pLog)
+{
+    unsigned char x;
+    long lagQ8[NUM_WHEELS];
+    unsigned long maxLagQ8[NUM_WHEELS];
+
+    portENTER_CRITICAL();
     {
-        /* TODO fix this (1's and 2's swapped) */
-        x2_set_motor (MOTOR1, ACCEL_DRIVE, motor2Speed (gLastSpeedOUnits + gLastTweakLeft));
-        x2_set_motor (MOTOR2, ACCEL_DRIVE, motor1Speed (gLastSpeedOUnits + gLastTweakRight));        
+        *pLog = gMotionControlLog;
+        for (x = 0; x < NUM_WHEELS; x++)
+        {
+            lagQ8[x] = gWheelControl[x].runLagQ8;
+            maxLagQ8[x] = gWheelControl[x].runMaxLagQ8;
+        }
     }
-    else
+    portEXIT_CRITICAL();
+
+    for (x = 0; x < NUM_WHEELS; x++)
     {
-        x2_set_motor (MOTOR1, BRAKE_LOW, 0);
-        x2_set_motor (MOTOR2, BRAKE_LOW, 0);        
+        pLog->meanErrorMmS[x] = 0;
+        if (pLog->numPeriods > 0)
+        {
+            pLog->meanErrorMmS[x] = (countsQ8ToMm (lagQ8[x]) * 1000) / ((long) pLog->numPeriods * MOTION_CONTROL_PERIOD_MS);
+        }
+        pLog->maxLagMm[x] = countsQ8ToMm (maxLagQ8[x]);
     }
+}
 
-    return true;
+/* Copy the speeds that the speed loop is heading for, in mm/s with forwards positive,
+ * into pTargetMmS, which must have room for NUM_WHEELS; any task may call this */
+void getWheelTargets (int * pTargetMmS)
+{
+    unsigned char x;
+
+    portENTER_CRITICAL();
+    {
+        for (x = 0; x < NUM_WHEELS; x++)
+        {
+            pTargetMmS[x] = gTargetMmS[x];
+        }
+    }
+    portEXIT_CRITICAL();
+}
+
+/* The speed loop task: runs at a fixed rate, at the highest priority, reading the
+ * wheel encoders, moving odometry on and setting the motor drives to give the
+ * speeds that the motion task has asked for.  It is the only reader of the encoders. */
+void vTaskMotionControl (void *pvParameters)
+{
+    portTickType xWakeTime;
+    portTickType xLastTime;
+    portTickType xNow;
+    unsigned int elapsedMs;
+    unsigned int jitterMs;
+    unsigned char encoderErrors;
+    int counts[NUM_WHEELS];
+    int targetMmS[NUM_WHEELS];
+    unsigned char targetGeneration;
+    unsigned char lastTargetGeneration = 0;
+    int setpointMmS[NUM_WHEELS] = {0, 0};
+    unsigned char driveFactorX100 = 100;
+    int lastSetpointMmS;
+    bool startRun;
+    bool rewrite;
+    bool goalActive;
+    bool goalEnded;
+    long goneQ8;
+    long goalRemainingQ8 = 0;
+    int limitMmS;
+    int driveOUnits[NUM_WHEELS];
+    bool driveChanged;
+    unsigned char x;
+
+    encoders_init (ENCODER_LEFT_A_PIN, ENCODER_LEFT_B_PIN, ENCODER_RIGHT_A_PIN, ENCODER_RIGHT_B_PIN);
+
+    xWakeTime = xTaskGetTickCount();
+    xLastTime = xWakeTime;
+    while (1)
+    {
+        vTaskDelayUntil (&xWakeTime, MOTION_CONTROL_PERIOD_MS / portTICK_RATE_MS);
+
+        counts[WHEEL_LEFT] = encoders_get_counts_and_reset_m1();
+        counts[WHEEL_RIGHT] = encoders_get_counts_and_reset_m2();
+        encoderErrors = encoders_check_error_m1() + encoders_check_error_m2();
+        odometryUpdate (counts[WHEEL_LEFT], counts[WHEEL_RIGHT]);
+
+        xNow = xTaskGetTickCount();
+        elapsedMs = (portTickType) (xNow - xLastTime) * portTICK_RATE_MS;
+        xLastTime = xNow;
+        if ((portTickType) (xNow - xWakeTime) * portTICK_RATE_MS >= MOTION_CONTROL_PERIOD_MS)
+        {
+            /* Missed a whole period: start again from now rather than run the
+             * missed periods back to back */
+            xWakeTime = xNow;
+        }
+
+        goalEnded = false;
+        portENTER_CRITICAL();
+        {
+            if (gGoalActive)
+            {
+                /* Count off how far the wheels have taken us towards the goal since last time */
+                goneQ8 = 0;
+                for (x = 0; x < NUM_WHEELS; x++)
+                {
+                    goneQ8 += gGoalForwards[x] ? counts[x] : -counts[x];
+                }
+                gGoalRemainingQ8 -= goneQ8 << 8;
+                if (gGoalPeriodsLeft > 0)
+                {
+                    gGoalPeriodsLeft--;
+                }
+                if (gGoalRemainingQ8 <= 0 || gGoalPeriodsLeft == 0)
+                {
+                    endGoal (gGoalRemainingQ8 <= 0);
+                    gTargetMmS[WHEEL_LEFT] = 0;
+                    gTargetMmS[WHEEL_RIGHT] = 0;
+                    gTargetGeneration++;
+                    goalEnded = true;
+                }
+                goalRemainingQ8 = gGoalRemainingQ8;
+            }
+            goalActive = gGoalActive;
+            for (x = 0; x < NUM_WHEELS; x++)
+            {
+                targetMmS[x] = gTargetMmS[x];
+            }
+            driveFactorX100 = gDriveFactorX100;
+            targetGeneration = gTargetGeneration;
+            startRun = gStartRun;
+            gStartRun = false;
+        }
+        portEXIT_CRITICAL();
+
+        if (goalEnded)
+        {
+            xSemaphoreGive (xGoalDoneSemaphore);
+        }
+
+        /* Heading for a goal, come down from the top speed in time to stop there */
+        if (goalActive)
+        {
+            limitMmS = profileLimitMmS (goalRemainingQ8);
+            for (x = 0; x < NUM_WHEELS; x++)
+            {
+                if (targetMmS[x] > limitMmS)
+                {
+                    targetMmS[x] = limitMmS;
+                }
+                else
+                {
+                    if (targetMmS[x] < -limitMmS)
+                    {
+                        targetMmS[x] = -limitMmS;
+                    }
+                }
+            }
+        }
+
+        if (targetMmS[WHEEL_LEFT] == 0 && targetMmS[WHEEL_RIGHT] == 0)
+        {
+            /* Stopped: hold the brakes on and forget any error */
+            if (!gWheelsBraked)
+            {
+                rob_x2_set_motors (BRAKE_LOW, 0, BRAKE_LOW, 0);
+                for (x = 0; x < NUM_WHEELS; x++)
+                {
+                    gWheelControl[x].driveOUnits = 0;
+                    gWheelControl[x].lagQ8 = 0;
+                    setpointMmS[x] = 0;
+                }
+                gWheelsBraked = true;
+            }
+        }
+        else
+        {
+            if (startRun)
+            {
+                portENTER_CRITICAL();
+                {
+                    RobMemset (&gMotionControlLog, 0, sizeof (gMotionControlLog));
+                    for (x = 0; x < NUM_WHEELS; x++)
+                    {
+                        gWheelControl[x].lagQ8 = 0;
+                        gWheelControl[x].runLagQ8 = 0;
+                        gWheelControl[x].runMaxLagQ8 = 0;
+                    }
+                }
+                portEXIT_CRITICAL();
+            }
+            else
+            {
+                /* Log how far off its nominal length the period just gone was */
+                jitterMs = elapsedMs >= MOTION_CONTROL_PERIOD_MS ? elapsedMs - MOTION_CONTROL_PERIOD_MS : MOTION_CONTROL_PERIOD_MS - elapsedMs;
+                portENTER_CRITICAL();
+                {
+                    gMotionControlLog.numPeriods++;
+                    if (elapsedMs > MOTION_CONTROL_PERIOD_MS)
+                    {
+                        gMotionControlLog.numLatePeriods++;
+                    }
+                    if (jitterMs > gMotionControlLog.maxJitterMs)
+                    {
+                        gMotionControlLog.maxJitterMs = jitterMs;
+                    }
+                    gMotionControlLog.numEncoderErrors += encoderErrors;
+                }
+                portEXIT_CRITICAL();
+            }
+
+            /* The motion task may have braked since the loop last drove the motors */
+            rewrite = gWheelsBraked || targetGeneration != lastTargetGeneration;
+            driveChanged = false;
+            for (x = 0; x < NUM_WHEELS; x++)
+            {
+                /* The speed loop follows a setpoint that gets to the target no
+                 * faster than the profile's acceleration allows, so a move is
+                 * accelerate, cruise and (see above) decelerate */
+                lastSetpointMmS = setpointMmS[x];
+                setpointMmS[x] = slewMmS (setpointMmS[x], targetMmS[x], elapsedMs);
+
+                /* Slowing down there's no sense in catching up on distance lost
+                 * getting going, that would only carry speed into the stop */
+                if ((setpointMmS[x] >= 0 && setpointMmS[x] < lastSetpointMmS && gWheelControl[x].lagQ8 > 0) ||
+                    (setpointMmS[x] <= 0 && setpointMmS[x] > lastSetpointMmS && gWheelControl[x].lagQ8 < 0))
+                {
+                    gWheelControl[x].lagQ8 = 0;
+                }
+
+                /* The run began part way through the period just gone, so there is
+                 * nothing to measure yet: just get the wheel going */
+                if (startRun)
+                {
+                    driveOUnits[x] = feedForwardOUnits (setpointMmS[x], driveFactorX100);
+                }
+                else
+                {
+                    driveOUnits[x] = speedLoop (&gWheelControl[x], setpointMmS[x], driveFactorX100, counts[x], elapsedMs);
+                }
+
+                if (driveOUnits[x] != gWheelControl[x].driveOUnits)
+                {
+                    driveChanged = true;
+                }
+                gWheelControl[x].driveOUnits = driveOUnits[x];
+            }
+
+            /* Both wheels are written if either has changed.  Don't overwrite a
+             * brake put on since the targets were read. */
+            if ((rewrite || driveChanged) && targetGeneration == gTargetGeneration)
+            {
+                setWheelDrives (IMMEDIATE_DRIVE, driveOUnits);
+            }
+            gWheelsBraked = false;
+        }
+        lastTargetGeneration = targetGeneration;
+    }
 }
 
 /* The queue that the motion control task uses */
 extern xQueueHandle xMotionCommandQueue;
 
-/* The queue that the homing task uses (in case we need to stop it) */
-extern xQueueHandle xHomeEventQueue;
+/* The queue that the homing task uses (in case we need to stop it) */
+extern xQueueHandle xHomeEventQueue;
+
+/* Fail the motion commands still queued */
+static void failQueuedMotion (void)
+{
+    CodedCommand codedMotionCommand;
+
+    while (xQueueReceive (xMotionCommandQueue, &codedMotionCommand, 0) == pdPASS)
+    {
+        sendSerialResponse (COMMS_RESPONSE_ERROR);
+    }
+}
+
+/* Throw away anything queued for the home state machine and tell it to stop */
+static void stopHoming (void)
+{
+    HomeEvent event = HOME_STOP_EVENT;
+    portBASE_TYPE xStatus;
+
+    xQueueReset (xHomeEventQueue);
+    xStatus = xQueueSend (xHomeEventQueue, &event, 0);
+    ASSERT_PARAM (xStatus == pdPASS, (unsigned long) xStatus);
+}
+
+/* Stop dead, from the task that hears the stop rather than when the motion task gets
+ * round to it: put the brakes on, fail the motion commands still queued, throw away
+ * anything queued for the home state machine and tell it to stop.  The motion task
+ * should then be sent the stop, for which this leaves room, to tidy up after whatever
+ * it was in the middle of. */
+void emergencyStop (void)
+{
+    brakeWheels();
+    recordStopLatency (getCommsMsSinceTerminator());
+    failQueuedMotion();
+    stopHoming();
+}
+
+/* Stop everything because something has gone wrong, e.g. a motor has stalled or
+ * something is in the way, from whichever task saw it: put the brakes on and tell
+ * the home state machine to stop, neither of which waits on anything, and leave the
+ * motion task to forget the motion that was cut short and fail it, and whatever was
+ * queued behind it, when it next looks up */
+void faultStop (void)
+{
+    brakeWheels();
+    stopHoming();
+    gFaultStopPending = true;
+}
 
 /* The Motion control task */
 void vTaskMotion (void *pvParameters)
 {
     bool success;
     bool isForwards;
+    bool replyNow;
     CodedCommand codedMotionCommand;
     portBASE_TYPE xStatus;
 
     while (1)
     {
-        xStatus = xQueueReceive (xMotionCommandQueue, &codedMotionCommand, portMAX_DELAY);
+        /* A fault stop while nothing was going on leaves nothing to clear up */
+        if (gMotionState == MOTION_STATE_IDLE && uxQueueMessagesWaiting (xMotionCommandQueue) == 0)
+        {
+            gFaultStopPending = false;
+        }
 
-        ASSERT_STRING (xStatus == pdPASS, "Failed to receive from motion command queue.");
+        /* Wait for a command, looking up every step to check on any motion in progress */
+        xStatus = xQueueReceive (xMotionCommandQueue, &codedMotionCommand, gMotionState == MOTION_STATE_IDLE ? portMAX_DELAY : MOTION_STEP_MS / portTICK_RATE_MS);
+
+        /* Clear up after a fault stop, which has already braked: forget the motion it
+         * cut short, fail that and every command that was waiting behind it */
+        if (gFaultStopPending)
+        {
+            gFaultStopPending = false;
+            stopNow();
+            preemptMotion();
+            if (xStatus == pdPASS)
+            {
+                sendSerialResponse (COMMS_RESPONSE_ERROR);
+            }
+            failQueuedMotion();
+            continue;
+        }
+
+        if (xStatus != pdPASS)
+        {
+            ASSERT_STRING (gMotionState != MOTION_STATE_IDLE, "Failed to receive from motion command queue.");
+
+            if (stepMotion (&success))
+            {
+                if (success)
+                {
+                    sendSerialResponse (COMMS_RESPONSE_OK);
+                }
+                else
+                {
+                    stopNow();
+                    sendSerialResponse (COMMS_RESPONSE_ERROR);
+                }
+            }
+            continue;
+        }
 
         success = false; /* Assume failure */
+        replyNow = true;
 
         /* Print out what command we're going to execute */
         rob_lcd_goto_xy (0, 1);
@@ -298,12 +1202,26 @@ void vTaskMotion (void *pvParameters)
                 {
                     case 'D': /* Move forward based on distance */
                     {
-                        success = moveDistance (value, isForwards);
+                        preemptMotion();
+                        success = startMoveDistance (value, isForwards);
+                        if (success)
+                        {
+                            gMotionState = MOTION_STATE_MOVING_DISTANCE;
+                            replyNow = false;
+                        }
                     }
                     break;
-                    case 'S': /* Set the speed */
+                    case 'S': /* Set the speed, which a move in progress picks up */
                     {
                         success = setSpeed (value);
+                        if (success && gMotionState == MOTION_STATE_MOVING_DISTANCE)
+                        {
+                            success = changeMoveSpeed();
+                            if (!success)
+                            {
+                                preemptMotion();
+                            }
+                        }
                     }
                     break;
                     default:
@@ -324,23 +1242,21 @@ void vTaskMotion (void *pvParameters)
                     value = -value;
                 }
 
-                success = turn (value);
+                rob_print_long (value);
+                rob_print_from_program_space (PSTR (" TURN."));
+
+                /* The speed loop does the turn, stepMotion() sees it end */
+                preemptMotion();
+                gMotionGoalNumber = startTurn (value);
+                gMotionState = MOTION_STATE_TURNING;
+                success = true;
+                replyNow = false;
             }
             break;
-            case 'S': /* Stop */
+            case 'S': /* Stop, which emergencyStop() has already done the urgent part of */
             {
-                HomeEvent event = HOME_STOP_EVENT;
-                
                 success = stopNow();
-                
-                /* Also stop the home state machine in case it is running */
-                xStatus = xQueueSend (xHomeEventQueue, &event, 0);
-                ASSERT_PARAM (xStatus == pdPASS, (unsigned long) xStatus);
-            }
-            break;
-            case 'I': /* Info? */
-            {
-                rob_print_from_program_space (PSTR ("TODO."));
+                preemptMotion();
             }
             break;
             default:
@@ -352,12 +1268,16 @@ void vTaskMotion (void *pvParameters)
 
         if (success)
         {
-            sendSerialString (OK_STRING, sizeof (OK_STRING));
+            if (replyNow)
+            {
+                sendSerialResponse (COMMS_RESPONSE_OK);
+            }
         }
         else
         {
             stopNow();
-            sendSerialString (ERROR_STRING, sizeof (ERROR_STRING));
+            preemptMotion();
+            sendSerialResponse (COMMS_RESPONSE_ERROR);
         }
     }
 }
\ No newline at end of file
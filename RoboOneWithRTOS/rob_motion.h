@@ -9,10 +9,44 @@
  */
 
 void vTaskMotion (void *pvParameters);
+void vTaskMotionControl (void *pvParameters);
 
 /* Slower than this and it won't go */
 #define MINIMUM_USEFUL_SPEED_O_UNITS 60
 
+/* O units of motor drive per cm/s, nominally: the real figure drops as the battery sags */
+#define CM_S_TO_O_UNITS_FACTOR 3
+
+/* Wheel geometry, for turning encoder counts into distances; the circumference and base
+ * here are nominal, the robot uses its calibration settings (see rob_calibration.h) */
+#define WHEEL_COUNTS_PER_REV 48
+#define WHEEL_CIRCUMFERENCE_MM 132
+#define WHEEL_BASE_MM 150 /* Between the wheels' contact points */
+
+typedef enum WheelTag
+{
+    WHEEL_LEFT = 0,
+    WHEEL_RIGHT,
+    NUM_WHEELS
+} Wheel;
+
+/* What the speed loop has seen since the wheels last started from rest */
+typedef struct MotionControlLogTag
+{
+    unsigned int numPeriods;
+    unsigned int numLatePeriods;       /* Periods that started a tick or more late */
+    unsigned int maxJitterMs;          /* Furthest a period has strayed from its nominal length */
+    int meanErrorMmS[NUM_WHEELS];      /* Commanded less achieved speed, averaged over the run */
+    unsigned int maxLagMm[NUM_WHEELS]; /* Furthest a wheel has been behind (or ahead of) where it should be */
+    unsigned int numEncoderErrors;
+} MotionControlLog;
+
+void getMotionControlLog (MotionControlLog * pLog);
+void getWheelTargets (int * pTargetMmS);
+
 bool move (int speedOUnits, int tweakLeft, int tweakRight);
 bool stopNow (void);
-bool turn (int degrees);
\ No newline at end of file
+void emergencyStop (void);
+void faultStop (void);
+bool turn (int degrees);
+void motionInit (void);
\ No newline at end of file
@@ -0,0 +1,140 @@
+/* Odometry - pose estimation part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+#include <rob_system.h>
+#include <rob_motion.h>
+#include <rob_odometry.h>
+#include <rob_calibration.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#define SIN_TABLE_SIZE 64 /* Entries per quarter turn */
+#define QUARTER_TURN 0x4000
+
+/* 2^32ths of a turn for each 1/256 mm that one wheel goes further than the other,
+ * times the distance between the wheels in mm */
+#define HEADING_PER_MM_Q8_X_WHEEL_BASE_MM ((long) (4294967296.0 / (2 * 3.14159265 * 256)))
+
+/* - GLOBALS -------------------------------------------------------------------------- */
+
+/* sin() over the first quarter turn, scaled by 32767 */
+static const int gSinTable[SIN_TABLE_SIZE + 1] PROGMEM =
+{
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+    6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767
+};
+
+/* The pose at full resolution, only touched by odometryUpdate(): distances in
+ * 1/256 mm, heading in 2^32ths of a turn */
+static long gXQ8 = 0;
+static long gYQ8 = 0;
+static long gDistanceQ8 = 0;
+static unsigned long gHeading = 0;
+
+/* The pose as everyone else sees it.  The sequence count is odd while the pose is
+ * being written, so a reader that sees the same even count either side of its copy
+ * knows that it has a consistent snapshot. */
+static volatile unsigned char gPoseSequence = 0;
+static volatile Pose gPose;
+
+/* - STATIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* sin() of an angle in 65536ths of a turn, scaled by 32767 */
+static long sinQ15 (unsigned int angle)
+{
+    unsigned int offset = angle & (QUARTER_TURN - 1);
+    unsigned char index;
+    long value;
+
+    if (angle & QUARTER_TURN)
+    {
+        offset = QUARTER_TURN - offset; /* Second and fourth quarters run backwards */
+    }
+
+    /* Interpolate between table entries */
+    index = offset >> 8;
+    value = (int) pgm_read_word (&gSinTable[index]);
+    if (index < SIN_TABLE_SIZE)
+    {
+        value += (((int) pgm_read_word (&gSinTable[index + 1]) - value) * (offset & 0xFF)) >> 8;
+    }
+
+    if (angle & (QUARTER_TURN << 1))
+    {
+        value = -value; /* Third and fourth quarters are negative */
+    }
+
+    return value;
+}
+
+/* Convert encoder counts into 1/256 mm */
+static long countsToMmQ8 (int counts)
+{
+    return ((long) counts * getCalibration (CAL_WHEEL_CIRCUMFERENCE_MM) * 256) / WHEEL_COUNTS_PER_REV;
+}
+
+/* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* Move the pose on by the counts that the wheel encoders have seen since the last
+ * call.  Called by the speed loop, which owns the encoders, once per period. */
+void odometryUpdate (int countsLeft, int countsRight)
+{
+    long leftQ8 = countsToMmQ8 (countsLeft);
+    long rightQ8 = countsToMmQ8 (countsRight);
+    long forwardsQ8 = (leftQ8 + rightQ8) / 2;
+    long turn = (rightQ8 - leftQ8) * (HEADING_PER_MM_Q8_X_WHEEL_BASE_MM / getCalibration (CAL_WHEEL_BASE_MM));
+    unsigned int midHeading;
+
+    /* Over one period the robot follows an arc; going along the chord, at the
+     * heading halfway round, is as good as working out the arc */
+    midHeading = (gHeading + turn / 2) >> 16;
+    gXQ8 += (forwardsQ8 * sinQ15 (midHeading + QUARTER_TURN)) >> 15;
+    gYQ8 += (forwardsQ8 * sinQ15 (midHeading)) >> 15;
+    gHeading += turn;
+    gDistanceQ8 += forwardsQ8;
+
+    gPoseSequence++;
+    gPose.xMm = gXQ8 >> 8;
+    gPose.yMm = gYQ8 >> 8;
+    gPose.heading = gHeading >> 16;
+    gPose.distanceMm = gDistanceQ8 >> 8;
+    gPoseSequence++;
+}
+
+/* Copy the latest pose into pPose.  This never blocks the speed loop: if it gets in
+ * part way through the copy, the copy is simply made again. */
+void getPose (Pose * pPose)
+{
+    unsigned char sequence;
+
+    do
+    {
+        sequence = gPoseSequence;
+        pPose->xMm = gPose.xMm;
+        pPose->yMm = gPose.yMm;
+        pPose->heading = gPose.heading;
+        pPose->distanceMm = gPose.distanceMm;
+    }
+    while ((sequence & 1) || (sequence != gPoseSequence));
+}
+
+/* Convert a heading into whole degrees, 0 to 359 */
+unsigned int headingToDegrees (unsigned int heading)
+{
+    return (unsigned int) ((((unsigned long) heading * 360) + 0x8000) >> 16) % 360;
+}
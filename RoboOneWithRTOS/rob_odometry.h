@@ -0,0 +1,23 @@
+/* Odometry - pose estimation part of an application for the Pololu Orangutan X2
+ *
+ * This application uses the Pololu AVR C/C++ Library.  For help, see:
+ * -User's guide: http://www.pololu.com/docs/0J20
+ * -Command reference: http://www.pololu.com/docs/0J18
+ *
+ * Created: 10/14/2013 7:10:02 PM
+ * Author: Rob Meades
+ */
+
+/* Where the robot is relative to where it started: x is forwards from there and
+ * y to the left, heading is anticlockwise in 65536ths of a turn */
+typedef struct PoseTag
+{
+    long xMm;
+    long yMm;
+    unsigned int heading;
+    long distanceMm; /* Travelled in all, going backwards counting as negative */
+} Pose;
+
+void odometryUpdate (int countsLeft, int countsRight);
+void getPose (Pose * pPose);
+unsigned int headingToDegrees (unsigned int heading);
\ No newline at end of file
@@ -10,14 +10,21 @@
 
 #include <string.h>
 #include <rob_system.h>
+#include <rob_calibration.h>
 #include <rob_comms.h>
+#include <rob_current.h>
 #include <rob_home.h>
+#include <rob_latency.h>
+#include <rob_motion.h>
+#include <rob_odometry.h>
 #include <rob_processing.h>
+#include <rob_sensor.h>
 #include <rob_wrappers.h>
 
 #include <FreeRTOS.h>
 #include <task.h>
 #include <queue.h>
+#include <pololu/orangutan.h>
 
 typedef enum CommandEncodeStateTag
 {
@@ -32,8 +39,379 @@ typedef enum CommandEncodeStateTag
     COMMAND_ENCODE_STATE_FINISHED
 } CommandEncodeState;
 
+#define INFO_STRING_LEN 128
+
+/* The commands that a frame of the binary protocol may carry */
+#define BINARY_COMMAND_IDS "FBRLSHIPCEAT!*X"
+
+/* The tasks, made in main.c */
+extern xTaskHandle xTaskHandles[NUM_TASKS];
+
+/* Short names for the tasks, in TaskId order, for the stack line of Info */
+static const char * taskToString[] = {"mot", "ctl", "home", "sns", "filt", "cur", "proc", "tx", "rx", "buz", "lcd", "prb"};
+
 /* - STATIC FUNCTIONS ----------------------------------------------------------------- */
 
+/* Append a ms latency histogram to pString as " 0:n 1:n ... 10+:n" */
+static void appendHistogram (char * pString, unsigned int * pHistogram, unsigned char size)
+{
+    unsigned char x;
+    size_t len;
+
+    for (x = 0; x < size; x++)
+    {
+        len = RobStrlen (pString);
+        pString[len] = ' ';
+        utoa (x, &pString[len + 1], 10);
+        len = RobStrlen (pString);
+        if (x == size - 1)
+        {
+            pString[len] = '+';
+            len++;
+        }
+        pString[len] = ':';
+        utoa (pHistogram[x], &pString[len + 1], 10);
+    }
+}
+
+/* Send the standard set of status information, a line at a time */
+static void sendInfo (void)
+{
+    char infoString[INFO_STRING_LEN];
+    unsigned int histogram[COMMS_LATENCY_HISTOGRAM_SIZE];
+    unsigned int latencyHistogram[LATENCY_HISTOGRAM_SIZE];
+    unsigned int latencyMaxMs;
+    CommsBufferStats bufferStats;
+    MotionControlLog motionControlLog;
+    CurrentLog currentLog;
+    unsigned char x;
+
+    /* Command receive latency histogram, in ms */
+    getCommsReceiveLatencyHistogram (histogram);
+    strcpy (infoString, "RX ms");
+    appendHistogram (infoString, histogram, COMMS_LATENCY_HISTOGRAM_SIZE);
+    sendSerialString (infoString, RobStrlen (infoString) + 1);
+
+    /* Scheduling latency histogram, in ms, and the worst case */
+    getSchedulingLatency (latencyHistogram, &latencyMaxMs);
+    strcpy (infoString, "SCHED ms");
+    appendHistogram (infoString, latencyHistogram, LATENCY_HISTOGRAM_SIZE);
+    strcat (infoString, " max ");
+    utoa (latencyMaxMs, &infoString[RobStrlen (infoString)], 10);
+    sendSerialString (infoString, RobStrlen (infoString) + 1);
+
+    /* Stop command terminator to brakes on, in ms, and the worst case */
+    getStopLatency (latencyHistogram, &latencyMaxMs);
+    strcpy (infoString, "STOP ms");
+    appendHistogram (infoString, latencyHistogram, LATENCY_HISTOGRAM_SIZE);
+    strcat (infoString, " max ");
+    utoa (latencyMaxMs, &infoString[RobStrlen (infoString)], 10);
+    sendSerialString (infoString, RobStrlen (infoString) + 1);
+
+    /* A distance sensor seeing an obstacle in the way to the reflex braking, in ms */
+    getReflexLatency (latencyHistogram, &latencyMaxMs);
+    strcpy (infoString, "REFLEX ms");
+    appendHistogram (infoString, latencyHistogram, LATENCY_HISTOGRAM_SIZE);
+    strcat (infoString, " max ");
+    utoa (latencyMaxMs, &infoString[RobStrlen (infoString)], 10);
+    sendSerialString (infoString, RobStrlen (infoString) + 1);
+
+    /* Comms buffer pool usage */
+    getCommsBufferStats (&bufferStats);
+    strcpy (infoString, "BUF used ");
+    utoa (bufferStats.inUse, &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " max ");
+    utoa (bufferStats.highWaterMark, &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " of ");
+    utoa (COMMS_NUM_BUFFERS, &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " dropped ");
+    utoa (bufferStats.numDropped, &infoString[RobStrlen (infoString)], 10);
+    sendSerialString (infoString, RobStrlen (infoString) + 1);
+
+    /* Speed loop timing and tracking over the current (or last) run */
+    getMotionControlLog (&motionControlLog);
+    strcpy (infoString, "SPEED periods ");
+    utoa (motionControlLog.numPeriods, &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " late ");
+    utoa (motionControlLog.numLatePeriods, &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " jitter ");
+    utoa (motionControlLog.maxJitterMs, &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " ms err L ");
+    itoa (motionControlLog.meanErrorMmS[WHEEL_LEFT], &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " R ");
+    itoa (motionControlLog.meanErrorMmS[WHEEL_RIGHT], &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " mm/s lag L ");
+    utoa (motionControlLog.maxLagMm[WHEEL_LEFT], &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " R ");
+    utoa (motionControlLog.maxLagMm[WHEEL_RIGHT], &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " mm enc ");
+    utoa (motionControlLog.numEncoderErrors, &infoString[RobStrlen (infoString)], 10);
+    sendSerialString (infoString, RobStrlen (infoString) + 1);
+
+    /* Motor currents, now and at worst, and the faults they have caused */
+    getCurrentLog (&currentLog);
+    strcpy (infoString, "CURRENT M1 ");
+    utoa (currentLog.average[MOTOR1], &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " max ");
+    utoa (currentLog.maxAverage[MOTOR1], &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " M2 ");
+    utoa (currentLog.average[MOTOR2], &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " max ");
+    utoa (currentLog.maxAverage[MOTOR2], &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " stalls ");
+    utoa (currentLog.numStalls, &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " overcurrents ");
+    utoa (currentLog.numOvercurrents, &infoString[RobStrlen (infoString)], 10);
+    sendSerialString (infoString, RobStrlen (infoString) + 1);
+
+    /* How much of its stack each task has never used, the least it has had to spare */
+    strcpy (infoString, "STACK free");
+    for (x = 0; x < NUM_TASKS; x++)
+    {
+        strcat (infoString, " ");
+        strcat (infoString, taskToString[x]);
+        strcat (infoString, " ");
+        utoa (uxTaskGetStackHighWaterMark (xTaskHandles[x]), &infoString[RobStrlen (infoString)], 10);
+    }
+    sendSerialString (infoString, RobStrlen (infoString) + 1);
+
+    /* The heap left over, which is all taken at start of day but for tunes being played */
+    strcpy (infoString, "HEAP free ");
+    utoa (xPortGetFreeHeapSize(), &infoString[RobStrlen (infoString)], 10);
+    strcat (infoString, " of ");
+    utoa (configTOTAL_HEAP_SIZE, &infoString[RobStrlen (infoString)], 10);
+    sendSerialString (infoString, RobStrlen (infoString) + 1);
+}
+
+/* Send where odometry reckons the robot is */
+static void sendPose (void)
+{
+    char poseString[INFO_STRING_LEN];
+    Pose pose;
+
+    getPose (&pose);
+    strcpy (poseString, "POSE x ");
+    ltoa (pose.xMm, &poseString[RobStrlen (poseString)], 10);
+    strcat (poseString, " y ");
+    ltoa (pose.yMm, &poseString[RobStrlen (poseString)], 10);
+    strcat (poseString, " mm heading ");
+    utoa (headingToDegrees (pose.heading), &poseString[RobStrlen (poseString)], 10);
+    strcat (poseString, " deg travelled ");
+    ltoa (pose.distanceMm, &poseString[RobStrlen (poseString)], 10);
+    strcat (poseString, " mm");
+    sendSerialString (poseString, RobStrlen (poseString) + 1);
+}
+
+/* Send the calibration settings in use and where they came from, on as many "CAL"
+ * lines as it takes to fit them in */
+static void sendCalibration (void)
+{
+    char calibrationString[INFO_STRING_LEN];
+    char name[CALIBRATION_NAME_SIZE];
+    unsigned char x;
+
+    strcpy (calibrationString, "CAL ");
+    switch (getCalibrationState())
+    {
+        case CALIBRATION_STATE_STORED:
+        {
+            strcat (calibrationString, "stored");
+        }
+        break;
+        case CALIBRATION_STATE_UNSAVED:
+        {
+            strcat (calibrationString, "unsaved");
+        }
+        break;
+        default:
+        {
+            strcat (calibrationString, "defaults");
+        }
+        break;
+    }
+    for (x = 0; x < NUM_CALIBRATION_FIELDS; x++)
+    {
+        /* Room for a space, the name, a space and five digits, plus the terminator */
+        if (RobStrlen (calibrationString) + CALIBRATION_NAME_SIZE + 7 > INFO_STRING_LEN)
+        {
+            sendSerialString (calibrationString, RobStrlen (calibrationString) + 1);
+            strcpy (calibrationString, "CAL");
+        }
+        getCalibrationName ((CalibrationField) x, name);
+        strcat (calibrationString, " ");
+        strcat (calibrationString, name);
+        strcat (calibrationString, " ");
+        utoa (getCalibration ((CalibrationField) x), &calibrationString[RobStrlen (calibrationString)], 10);
+    }
+    sendSerialString (calibrationString, RobStrlen (calibrationString) + 1);
+}
+
+/* Act on the string of a calibration command: "save", "load", "defaults" or the
+ * name of a setting, a space and its new value.  Returns false if it made no sense
+ * or couldn't be done. */
+static bool doCalibration (char * pString)
+{
+    unsigned char x = 0;
+    unsigned long value = 0;
+
+    if (strcmp (pString, "save") == 0)
+    {
+        return saveCalibration();
+    }
+    if (strcmp (pString, "load") == 0)
+    {
+        return loadCalibration();
+    }
+    if (strcmp (pString, "defaults") == 0)
+    {
+        restoreCalibrationDefaults();
+        return true;
+    }
+
+    /* Split the name from the value */
+    while (pString[x] != ' ')
+    {
+        if (pString[x] == 0)
+        {
+            return false;
+        }
+        x++;
+    }
+    pString[x] = 0;
+    x++;
+    if (pString[x] == 0)
+    {
+        return false;
+    }
+    for (; pString[x] != 0; x++)
+    {
+        if (pString[x] < '0' || pString[x] > '9')
+        {
+            return false;
+        }
+        value = value * 10 + (pString[x] - '0');
+        if (value > 0xFFFF)
+        {
+            return false;
+        }
+    }
+
+    return setCalibration (pString, (unsigned int) value);
+}
+
+/* Act on the string of a sensor telemetry command: the ms between frames, 0 to stop
+ * them, then optionally a space and how many cm a sensor must move by for a frame
+ * to be worth sending.  Returns false if it made no sense. */
+static bool doTelemetry (const char * pString)
+{
+    unsigned long values[2] = {0, 0};
+    unsigned char numValues = 0;
+    bool inValue = false;
+    unsigned char x;
+
+    for (x = 0; pString[x] != 0; x++)
+    {
+        if (pString[x] == ' ')
+        {
+            inValue = false;
+        }
+        else
+        {
+            if (pString[x] < '0' || pString[x] > '9')
+            {
+                return false;
+            }
+            if (!inValue)
+            {
+                if (numValues >= 2)
+                {
+                    return false;
+                }
+                numValues++;
+                inValue = true;
+            }
+            values[numValues - 1] = values[numValues - 1] * 10 + (pString[x] - '0');
+            if (values[numValues - 1] > 0xFFFF)
+            {
+                return false;
+            }
+        }
+    }
+    if (numValues == 0 || values[1] > 0xFF)
+    {
+        return false;
+    }
+
+    return setSensorTelemetry ((unsigned int) values[0], (unsigned char) values[1]);
+}
+
+/* Check the value and units of a coded command, however it arrived, and put the value
+ * in its place: it is in cm or cm/s for Forwards and Backwards, in degrees for a turn,
+ * and nothing else has one (the string of an A, T, C or * goes in afterwards).
+ * Return: success if they make sense for the command */
+static bool codeValue (CodedCommand * pCodedCommand, unsigned int value)
+{
+    bool success = true;
+    unsigned char id = pCodedCommand->buffer[CODED_COMMAND_ID_POS];
+    unsigned char units = pCodedCommand->buffer[CODED_COMMAND_UNITS_POS];
+
+    if (id == 'R' || id == 'L')
+    {
+        if (value > MAX_TURN_DEGREES)
+        {
+            success = false;
+        }
+        else
+        {
+            /* Default turn is DEFAULT_TURN_DEGREES if not specified */
+            if (value == 0)
+            {
+                value = DEFAULT_TURN_DEGREES;
+            }
+        }
+
+        pCodedCommand->buffer[CODED_COMMAND_VALUE_POS + 1] = (unsigned char) value;
+    }
+    else if (id == 'F' || id == 'B')
+    {
+        /* Forwards or backwards have to have units */
+        if (units == UNITS_ARE_DISTANCE)
+        {
+            if (value > MAX_DISTANCE_CM)
+            {
+                success = false;
+            }
+        }
+        else if (units == UNITS_ARE_SPEED)
+        {
+            if (value > MAX_SPEED_CM_SEC)
+            {
+                success = false;
+            }
+        }
+        else
+        {
+            success = false;
+        }
+
+        if (success)
+        {
+            /* Write the value in a specific way so that we can remove it in the same order */
+            pCodedCommand->buffer[CODED_COMMAND_VALUE_POS]     = (unsigned char) (value >> 8);
+            pCodedCommand->buffer[CODED_COMMAND_VALUE_POS + 1] = (unsigned char) value;
+        }
+    }
+    else
+    {
+        if (value > 0 || units > 0)
+        {
+            success = false;
+        }
+    }
+
+    return success;
+}
+
 /* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
 
 /* The queues that the processing task uses */
@@ -41,7 +419,6 @@ extern xQueueHandle xCommsReceiveQueue;
 extern xQueueHandle xMotionCommandQueue;
 extern xQueueHandle xSensorCommandQueue;
 extern xQueueHandle xHomeEventQueue;
-extern xQueueHandle xCommsTransmitQueue;
 
 /* The processing task */
 void vTaskProcessing (void *pvParameters)
@@ -50,6 +427,7 @@ void vTaskProcessing (void *pvParameters)
     CodedCommand codedCommand;
     portBASE_TYPE xStatus;
     bool echo = false;
+    bool parsed;
 
     while (1)
     {
@@ -59,15 +437,36 @@ void vTaskProcessing (void *pvParameters)
 
         if (!echo)
         {
-            if (processCommand (pCommandString, &codedCommand))
+            /* However it arrived, the command comes out coded the same and goes the same way */
+            if (isCommsBinary())
+            {
+                parsed = processBinaryCommand (pCommandString, &codedCommand);
+            }
+            else
+            {
+                parsed = processCommand (pCommandString, &codedCommand);
+            }
+
+            if (parsed)
             {
                 if (codedCommand.buffer[CODED_COMMAND_ID_POS] != 'E' &&
                     codedCommand.buffer[CODED_COMMAND_ID_POS] != 'A' &&
                     codedCommand.buffer[CODED_COMMAND_ID_POS] != 'T' &&
                     codedCommand.buffer[CODED_COMMAND_ID_POS] != '!' &&
 					codedCommand.buffer[CODED_COMMAND_ID_POS] != '*' &&
+					codedCommand.buffer[CODED_COMMAND_ID_POS] != 'I' &&
+					codedCommand.buffer[CODED_COMMAND_ID_POS] != 'P' &&
+					codedCommand.buffer[CODED_COMMAND_ID_POS] != 'C' &&
+					codedCommand.buffer[CODED_COMMAND_ID_POS] != 'X' &&
 					codedCommand.buffer[CODED_COMMAND_ID_POS] != 'H')
                 {
+                    /* A stop can't wait its turn: brake now, making room for the
+                     * motion task to be told so that it can tidy up */
+                    if (codedCommand.buffer[CODED_COMMAND_ID_POS] == 'S')
+                    {
+                        emergencyStop();
+                    }
+
                     /* Send the command off to the motion command queue */
                     /* For some very weird reason the xQueueSend function here never, ever,
                     ** returns errQUEUE_FULL, even if the queue really is full.  To combat
@@ -84,12 +483,24 @@ void vTaskProcessing (void *pvParameters)
 
                     if (xStatus != pdPASS)
                     {
-                        sendSerialString (BUSY_STRING, sizeof (BUSY_STRING));
+                        sendSerialResponse (COMMS_RESPONSE_BUSY);
                     }
                 }
                 else
                 {
-                    if (codedCommand.buffer[CODED_COMMAND_ID_POS] == '*')
+                    if (codedCommand.buffer[CODED_COMMAND_ID_POS] == '*' && codedCommand.buffer[CODED_COMMAND_VALUE_POS] != 0)
+                    {
+                        /* With a string it's a telemetry subscription, which is just a setting */
+                        if (doTelemetry ((const char *) &(pCommandString[codedCommand.buffer[CODED_COMMAND_VALUE_POS]])))
+                        {
+                            sendSerialResponse (COMMS_RESPONSE_OK);
+                        }
+                        else
+                        {
+                            sendSerialResponse (COMMS_RESPONSE_ERROR);
+                        }
+                    }
+                    else if (codedCommand.buffer[CODED_COMMAND_ID_POS] == '*')
                     {
                         /* Send the command off to the sensor command queue */
 						if (uxQueueMessagesWaiting (xSensorCommandQueue) < SENSOR_COMMAND_QUEUE_SIZE)
@@ -103,31 +514,68 @@ void vTaskProcessing (void *pvParameters)
 
 						if (xStatus != pdPASS)
 						{
-							sendSerialString (BUSY_STRING, sizeof (BUSY_STRING));
+							sendSerialResponse (COMMS_RESPONSE_BUSY);
 						}
                     }
                     else
                     {
-                        /* E, !, A, T and H are dealt with locally */
+                        /* E, !, A, T, I, P, C, X and H are dealt with locally */
                         if (codedCommand.buffer[CODED_COMMAND_ID_POS] == 'E')
                         {
                             echo = true;
-                            sendSerialString (OK_STRING, sizeof (OK_STRING));
+                            sendSerialResponse (COMMS_RESPONSE_OK);
                         }
                         else if (codedCommand.buffer[CODED_COMMAND_ID_POS] == '!')
                         {
-                            sendSerialString (OK_STRING, sizeof (OK_STRING));
+                            sendSerialResponse (COMMS_RESPONSE_OK);
                         }
                         else if (codedCommand.buffer[CODED_COMMAND_ID_POS] == 'A')
                         {
                             rob_lcd_goto_xy (0, 1);
                             rob_print ((const char *) &(pCommandString[codedCommand.buffer[CODED_COMMAND_VALUE_POS]]));
-                            sendSerialString (OK_STRING, sizeof (OK_STRING));
+                            sendSerialResponse (COMMS_RESPONSE_OK);
                         }
                         else if (codedCommand.buffer[CODED_COMMAND_ID_POS] == 'T')
                         {
-                            rob_wait_play ((const char *) &(pCommandString[codedCommand.buffer[CODED_COMMAND_VALUE_POS]]));
-                            sendSerialString (OK_STRING, sizeof (OK_STRING));
+                            /* Queued, it'll play in the background */
+                            if (rob_play ((const char *) &(pCommandString[codedCommand.buffer[CODED_COMMAND_VALUE_POS]]), PNULL))
+                            {
+                                sendSerialResponse (COMMS_RESPONSE_OK);
+                            }
+                            else
+                            {
+                                sendSerialResponse (COMMS_RESPONSE_BUSY);
+                            }
+                        }
+                        else if (codedCommand.buffer[CODED_COMMAND_ID_POS] == 'I')
+                        {
+                            sendInfo();
+                            sendSerialResponse (COMMS_RESPONSE_OK);
+                        }
+                        else if (codedCommand.buffer[CODED_COMMAND_ID_POS] == 'P')
+                        {
+                            sendPose();
+                            sendSerialResponse (COMMS_RESPONSE_OK);
+                        }
+                        else if (codedCommand.buffer[CODED_COMMAND_ID_POS] == 'C')
+                        {
+                            /* Without a string, just say what the settings are */
+                            if (codedCommand.buffer[CODED_COMMAND_VALUE_POS] == 0)
+                            {
+                                sendCalibration();
+                                sendSerialResponse (COMMS_RESPONSE_OK);
+                            }
+                            else
+                            {
+                                if (doCalibration ((char *) &(pCommandString[codedCommand.buffer[CODED_COMMAND_VALUE_POS]])))
+                                {
+                                    sendSerialResponse (COMMS_RESPONSE_OK);
+                                }
+                                else
+                                {
+                                    sendSerialResponse (COMMS_RESPONSE_ERROR);
+                                }
+                            }
                         }
                         else if (codedCommand.buffer[CODED_COMMAND_ID_POS] == 'H')
                         {
@@ -143,12 +591,18 @@ void vTaskProcessing (void *pvParameters)
 
                             if (xStatus != pdPASS)
                             {
-                                sendSerialString (BUSY_STRING, sizeof (BUSY_STRING));
+                                sendSerialResponse (COMMS_RESPONSE_BUSY);
                             }
                         }
+                        else if (codedCommand.buffer[CODED_COMMAND_ID_POS] == 'X')
+                        {
+                            /* Answer in the protocol the command came in, then switch */
+                            sendSerialResponse (COMMS_RESPONSE_OK);
+                            setCommsBinary (!isCommsBinary());
+                        }
                         else
                         {
-                            ASSERT_ALWAYS_STRING ("Only IDs E, !, A, T and H are handled locally.");
+                            ASSERT_ALWAYS_STRING ("Only IDs E, !, A, T, I, P, C, X and H are handled locally.");
                         }
                     }
                 }
@@ -157,14 +611,14 @@ void vTaskProcessing (void *pvParameters)
             {
                 rob_lcd_goto_xy (0, 1);
                 rob_print_from_program_space (PSTR ("Bad command"));
-                sendSerialString (ERROR_STRING, sizeof (ERROR_STRING));
+                sendSerialResponse (COMMS_RESPONSE_ERROR);
             }
 
-            RobFree (pCommandString); /* Free up the memory that held the received command string */
+            freeCommsBuffer (pCommandString); /* Give back the buffer that held the received command string */
         }
         else
         {
-            xQueueSend (xCommsTransmitQueue, &pCommandString, 0); /* Forward to the transmit queue */
+            sendCommsBuffer (pCommandString); /* Forward to the transmit queue, which takes ownership of the buffer */
         }
     }
 }
@@ -179,18 +633,21 @@ void vTaskProcessing (void *pvParameters)
  * [#x] S[top]
  * [#x] H[ome]
  * [#x] I[nfo?]
+ * [#x] P[ose?]
+ * [#x] C[alibration]["setting value"|"save"|"load"|"defaults"]
  * [#x] E[cho]
  * [#x] A"[]"
  * [#x] T"[]"
  * [#x] !
- * [#x] *
+ * [#x] *["ms[ cm]"]
+ * [#x] X
  *
  * Format of coded command is:
  * - index (1 byte 0-255),
- * - ID (1 byte from FBRLSHMDVPIEAT!),
+ * - ID (1 byte from FBRLSHMDVPCIEAT!*X),
  * - value (2 bytes) and it is actually converted to cm or cm/s here, with the higher nibbles to the left,
- *   in the case of A/T this is the position of the start of the printable string,
- * - units (1 byte from S for speed D for distance), in the case of A/T this contains the string length. */
+ *   in the case of A/T/C and * this is the position of the start of the printable string (0 if C or * has none),
+ * - units (1 byte from S for speed D for distance), in the case of A/T/C and * this contains the string length. */
 
 /* Return: success if the command was parseable */
 bool processCommand (char * pCommandString, CodedCommand *pCodedCommand)
@@ -307,6 +764,8 @@ bool processCommand (char * pCommandString, CodedCommand *pCodedCommand)
             case 'A':
             case 't':
             case 'T':
+            case 'c':
+            case 'C':
             {
                 if ((commandEncodeState == COMMAND_ENCODE_STATE_NULL || commandEncodeState == COMMAND_ENCODE_STATE_GET_ID) &&
                     (pCodedCommand->buffer[CODED_COMMAND_ID_POS] == 0))
@@ -338,8 +797,12 @@ bool processCommand (char * pCommandString, CodedCommand *pCodedCommand)
             case 'H':
             case 'I':
             case 'i':
+            case 'P':
+            case 'p':
             case 'E':
             case 'e':
+            case 'X':
+            case 'x':
             {
                 if ((commandEncodeState == COMMAND_ENCODE_STATE_NULL || commandEncodeState == COMMAND_ENCODE_STATE_GET_ID) &&
                     (pCodedCommand->buffer[CODED_COMMAND_ID_POS] == 0))
@@ -356,7 +819,7 @@ bool processCommand (char * pCommandString, CodedCommand *pCodedCommand)
                     (pCodedCommand->buffer[CODED_COMMAND_ID_POS] == 0))
                 {
                     pCodedCommand->buffer[CODED_COMMAND_ID_POS] = y;
-                    commandEncodeState = COMMAND_ENCODE_STATE_FINISHED;
+                    commandEncodeState = (y == '*') ? COMMAND_ENCODE_STATE_GET_OPENING_QUOTE : COMMAND_ENCODE_STATE_FINISHED; /* * may have a telemetry string */
                 }
             }            
             break;
@@ -434,64 +897,16 @@ bool processCommand (char * pCommandString, CodedCommand *pCodedCommand)
     if (success)
     {
         unsigned char id = pCodedCommand->buffer[CODED_COMMAND_ID_POS];
-        unsigned char units = pCodedCommand->buffer[CODED_COMMAND_UNITS_POS];
         unsigned int value;
 
         value = (unsigned int) mantissa * 100 + fractional;
-
         if (id == 'R' || id == 'L')
         {
             value /= 100; /* values in degrees must have the * 100 multiplier (that was converting metres into centimetres) removed */
-            if (value > MAX_TURN_DEGREES)
-            {
-                success = false;
-            }
-            else
-            {
-                /* Default turn is DEFAULT_TURN_DEGREES if not specified */
-                if (value == 0)
-                {
-                    value = DEFAULT_TURN_DEGREES;
-                }
-            }
-
-            pCodedCommand->buffer[CODED_COMMAND_VALUE_POS + 1] = (unsigned char) value;
         }
+        success = codeValue (pCodedCommand, value);
 
-        /* Forwards or backwards have to have units */
-        if (id == 'F' || id == 'B')
-        {
-            if (units == 0)
-            {
-                success = false;
-            }
-            else
-            {
-                if (units == UNITS_ARE_DISTANCE)
-                {
-                    if (value > MAX_DISTANCE_CM)
-                    {
-                        success = false;
-                    }
-                }
-                else
-                {
-                    if (value > MAX_SPEED_CM_SEC)
-                    {
-                        success = false;
-                    }
-                }
-
-                if (success)
-                {
-                    /* Write the value in a specific way so that we can remove it in the same order */
-                    pCodedCommand->buffer[CODED_COMMAND_VALUE_POS]     = (unsigned char) (value >> 8);
-                    pCodedCommand->buffer[CODED_COMMAND_VALUE_POS + 1] = (unsigned char) value;
-                }
-            }
-        }
-
-        if (id == 'A' || id == 'T')
+        if (success && (id == 'A' || id == 'T'))
         {
             /* For an Alphanumeric/Tune string, value contains the position of the start of the body of the string and units the length of it */
             pCodedCommand->buffer[CODED_COMMAND_VALUE_POS] = 0;
@@ -509,15 +924,97 @@ bool processCommand (char * pCommandString, CodedCommand *pCodedCommand)
             }
         }
 
-        /* None of Stop, Home, Info, "!" or "*" can have values or units */
-        if (id == 'S' || id == 'H' || id == 'I' || id == '!' || id == '*')
+        if (success && (id == 'C' || id == '*'))
         {
-            if (value > 0 || units > 0)
+            /* Calibration's, and the sensor command's, string is optional but, if there is one, it's held like an A/T string */
+            pCodedCommand->buffer[CODED_COMMAND_VALUE_POS] = 0;
+            pCodedCommand->buffer[CODED_COMMAND_VALUE_POS + 1] = 0;
+            pCodedCommand->buffer[CODED_COMMAND_UNITS_POS] = 0;
+
+            if (posOpeningQuote > 0)
             {
-                success = false;
+                if (posClosingQuote > posOpeningQuote + 1)
+                {
+                    pCodedCommand->buffer[CODED_COMMAND_VALUE_POS] = posOpeningQuote + 1;
+                    pCodedCommand->buffer[CODED_COMMAND_UNITS_POS] = posClosingQuote - posOpeningQuote - 1;
+                }
+                else
+                {
+                    success = false;
+                }
             }
         }
     }
 
     return success;
 }
+
+/* Process a frame of the binary protocol, as received, into a coded command.  The
+ * payload of the frame is the coded command as held here, except that the value is
+ * little-endian, then for A, T, C and * their string, without quotes or terminator:
+ *
+ * - index (1 byte 0-99, 255 for none),
+ * - ID (1 byte from FBRLSHIPCEAT!*X),
+ * - value (2 bytes, low byte first) in cm or cm/s for F and B, in degrees for R and L, else 0,
+ * - units (1 byte, D for distance or S for speed for F and B, else 0),
+ * - the string, if any.
+ *
+ * The frame is decoded where it is, so the string ends up at the same sort of position
+ * in the buffer as an ASCII command's and the coded command is used in the same way. */
+
+/* Return: success if the frame was good and the command makes sense */
+bool processBinaryCommand (char * pFrame, CodedCommand * pCodedCommand)
+{
+    unsigned char * pPayload = (unsigned char *) pFrame;
+    unsigned char payloadSize;
+    unsigned char stringSize;
+    unsigned char id;
+    unsigned int value;
+
+    payloadSize = decodeCommsFrame (pFrame);
+    if (payloadSize < CODED_COMMAND_SIZE)
+    {
+        return false;
+    }
+
+    id = pPayload[CODED_COMMAND_ID_POS];
+    if (id == 0 || strchr (BINARY_COMMAND_IDS, id) == PNULL)
+    {
+        return false;
+    }
+    if (pPayload[CODED_COMMAND_INDEX_POS] > 99 && pPayload[CODED_COMMAND_INDEX_POS] != CODED_COMMAND_INDEX_UNUSED)
+    {
+        return false;
+    }
+
+    RobMemset (&(pCodedCommand->buffer), 0, sizeof (pCodedCommand->buffer));
+    pCodedCommand->buffer[CODED_COMMAND_INDEX_POS] = pPayload[CODED_COMMAND_INDEX_POS];
+    pCodedCommand->buffer[CODED_COMMAND_ID_POS] = id;
+    pCodedCommand->buffer[CODED_COMMAND_UNITS_POS] = pPayload[CODED_COMMAND_UNITS_POS];
+    value = pPayload[CODED_COMMAND_VALUE_POS] | ((unsigned int) pPayload[CODED_COMMAND_VALUE_POS + 1] << 8);
+    if (!codeValue (pCodedCommand, value))
+    {
+        return false;
+    }
+
+    /* A and T must have a string, C and * may, nothing else can */
+    stringSize = payloadSize - CODED_COMMAND_SIZE;
+    if (stringSize > 0)
+    {
+        if (id != 'A' && id != 'T' && id != 'C' && id != '*')
+        {
+            return false;
+        }
+        pCodedCommand->buffer[CODED_COMMAND_VALUE_POS] = CODED_COMMAND_SIZE;
+        pCodedCommand->buffer[CODED_COMMAND_UNITS_POS] = stringSize;
+    }
+    else
+    {
+        if (id == 'A' || id == 'T')
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
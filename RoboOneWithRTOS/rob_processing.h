@@ -26,4 +26,6 @@ typedef struct CodedCommandTag
 
 void vTaskProcessing (void *pvParameters);
 
-bool processCommand (char * pCommandString, CodedCommand *pCodedCommand);
\ No newline at end of file
+bool processCommand (char * pCommandString, CodedCommand *pCodedCommand);
+
+bool processBinaryCommand (char * pFrame, CodedCommand * pCodedCommand);
\ No newline at end of file
@@ -8,21 +8,57 @@
  * Author: Rob Meades
  */
 
-#include <rob_system.h>
-#include <rob_wrappers.h>
-#include <rob_processing.h>
-#include <rob_comms.h>
+#include <string.h>
+#include <rob_system.h>
+#include <rob_wrappers.h>
+#include <rob_processing.h>
+#include <rob_comms.h>
+#include <rob_motion.h>
+#include <rob_home.h>
+#include <rob_calibration.h>
+#include <rob_latency.h>
+#include <rob_sensor.h>
+#include <rob_distance.h>
 #include <FreeRTOS.h>
 #include <task.h>
 #include <queue.h>
-#include <pololu/orangutan.h>
-
-/* The number of ADC samples to average over */
-#define NUM_ADC_SAMPLES 10
-
-/* The number of ADCS to read when the read command comes in */
-#define MAX_NUM_ADCS 6
+#include <pololu/orangutan.h>
+#include <sharp_data.h>
 
+/* How often the filters take a reading from each sensor, how many of those the spike
+ * rejector takes the median of and how hard the smoothing after it is: each reading
+ * moves the smoothed value 1 / (1 << SENSOR_IIR_SHIFT) of the way to it */
+#define SENSOR_FILTER_PERIOD_MS 10
+#define SENSOR_MEDIAN_SAMPLES 5
+#define SENSOR_IIR_SHIFT 2
+
+/* Once nothing is there, how many ADC codes nearer than the furthest a sensor can see
+ * (40 cm) something has to be to count; it then counts until it goes beyond 40 cm */
+#define SENSOR_DETECT_HYSTERESIS_CODES 8
+
+/* How many raw readings in a row must put something within the obstacle distance, in
+ * the way, for the reflex to brake: enough to ignore a lone spike, no more, since the
+ * median and smoothing lag too far behind for a reflex */
+#define SENSOR_REFLEX_READINGS 2
+
+/* Which wheels' motion, and in which direction, each sensor watches over */
+#define SENSOR_GUARDS_LEFT     0x01
+#define SENSOR_GUARDS_RIGHT    0x02
+#define SENSOR_GUARDS_BOTH     (SENSOR_GUARDS_LEFT | SENSOR_GUARDS_RIGHT)
+#define SENSOR_GUARDS_BACKWARDS 0x80
+
+#define EVENT_STRING_LEN 32
+
+/* Sensor telemetry: a frame is TELEMETRY_FRAME_START then each sensor's distance in
+ * cm as two hex digits, 00 for nothing there, in channelToString order.  A frame is
+ * 14 bytes with its terminator, which take 15 ms at 9600 baud, so frames can't come
+ * faster than TELEMETRY_MIN_PERIOD_MS without crowding out everything else; when only
+ * changes are asked for a frame still goes every TELEMETRY_KEEPALIVE_MS, or every
+ * period if that is longer. */
+#define TELEMETRY_FRAME_START '='
+#define TELEMETRY_MIN_PERIOD_MS 20
+#define TELEMETRY_KEEPALIVE_MS 1000
+
 /* The string length of one reading from an ADC (NOT including terminator), intended as "xx:yyyy ",
  * where xx is the sensor string and yyyy is the distance in cm. */
 #define ADC_READING_STRING_LEN 7
@@ -34,7 +70,36 @@
 #define NOTHING_THERE_STRING ":    "
 #define NOTHING_THERE_STRING_LEN 5 /* Not including terminator */
 
-/* - GLOBALS -------------------------------------------------------------------------- */
+/* The filters for one sensor */
+typedef struct SensorFilterTag
+{
+    unsigned int recent[SENSOR_MEDIAN_SAMPLES]; /* The latest raw ADC codes */
+    unsigned char pos;                          /* Where the next goes in recent[] */
+    unsigned int smoothedX16;                   /* The smoothed ADC code, times 16 */
+    bool detected;
+    unsigned char numInTheWay;                  /* Raw readings in a row with something in the way */
+    portTickType xInTheWayTick;                 /* When the first of those was taken */
+} SensorFilter;
+
+/* - GLOBALS -------------------------------------------------------------------------- */
+
+/* Written only by the sensor filter task */
+static SensorFilter gSensorFilter[MAX_NUM_ADCS];
+static bool gSensorFiltersPrimed = false;
+
+/* What the filters make of each sensor, in mm, 0 for nothing there */
+static unsigned int gSensorDistanceMm[MAX_NUM_ADCS];
+
+/* The ms between telemetry frames, 0 for none, the cm a sensor must move by for a
+ * frame to go, 0 for every period regardless, and whether that has just changed */
+static unsigned int gTelemetryPeriodMs = 0;
+static unsigned char gTelemetryDeltaCm = 0;
+static bool gTelemetryRestart = false;
+
+/* Written only by the sensor filter task: ms since the last telemetry frame and
+ * what it said */
+static unsigned int gTelemetryMsSinceFrame;
+static unsigned char gTelemetrySentCm[MAX_NUM_ADCS];
 
 /* - STATIC VARIABLES ----------------------------------------------------------------- */
 
@@ -53,58 +118,346 @@
  * BL Back Left, BR Back Right and BB is back.
  */
 
-static const char * channelToString[] = {"FF", "FL", "BL", "FR", "BR", "BB"};
+static const char * channelToString[] = {"FF", "FL", "BL", "FR", "BR", "BB"};
+
+/* What each sensor watches over, in the same order: something in front of FF is in
+ * the way if either wheel is going forwards, in front of FL only if the left wheel
+ * is, and so on; so turning on the spot is held up only by what it would hit */
+static const unsigned char gSensorGuards[MAX_NUM_ADCS] =
+{
+    SENSOR_GUARDS_BOTH,
+    SENSOR_GUARDS_LEFT,
+    SENSOR_GUARDS_LEFT | SENSOR_GUARDS_BACKWARDS,
+    SENSOR_GUARDS_RIGHT,
+    SENSOR_GUARDS_RIGHT | SENSOR_GUARDS_BACKWARDS,
+    SENSOR_GUARDS_BOTH | SENSOR_GUARDS_BACKWARDS
+};
 
 /* - STATIC FUNCTIONS ----------------------------------------------------------------- */
 
-/* Calibrate the ADCs, used in case the supply voltage has changed, which it might
-   do quite frequently as we're on battery */
-static void calibrateAdcs (void)
-{
-    set_millivolt_calibration (read_vcc_millivolts());
-}
-
-/* Read a given ADC */
-static unsigned int readAdc (unsigned char channel)
-{
-    return analog_read_average_millivolts (channel, NUM_ADC_SAMPLES);
-}
-
-/* Determine if an object has been detected.  10 mV
- * is the minimum reading, 300 mV equates to a distance of
- * 40 cm, 256 millivolts is 50 cm, so use that. */
-static bool objectDetected (unsigned int millivolts)
-{
-    bool detected = false;
-    
-    if (millivolts > 256)
-    {
-        detected = true;
-    }
-    
-    return detected;
-}
-
-/* Convert an ADC reading into a distance in cm.
- * From the Sharp GP2Y0A41SK0F data sheet, the sensors can 
- * measure from 40 cm to 3.5 cm with a linear response, which
- * I calculate to be V = 12.8 * (1 / (distance in cm)).  This works
- * for voltages up to 3 volts (equating to a distance of 3.5 cm).
- * Below about 0.3 volts there is nothing there. */
-static unsigned int voltageToDistance (unsigned int millivolts)
-{
-    unsigned int distance = 1280; /* Equivalent to 10 mV, which is about the minimum reading */
-    
-    if (millivolts > 10)
-    {        
-        distance = 12800 / (millivolts);
-    }
-    
-    return distance;
-}
-
-/* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
+/* Read a given ADC: the average of its latest background samples, as a raw ADC code,
+ * which takes no time */
+static unsigned int readAdc (unsigned char channel)
+{
+    return analog_read_background_average (channel);
+}
+
+/* The median of a sensor's latest readings: the Sharp sensors put out a spike now and
+ * again, around each measurement they make, and this throws out up to
+ * SENSOR_MEDIAN_SAMPLES / 2 of them in a row where an average would be dragged about */
+static unsigned int medianCode (const SensorFilter * pFilter)
+{
+    unsigned int sorted[SENSOR_MEDIAN_SAMPLES];
+    unsigned int code;
+    unsigned char x;
+    unsigned char y;
+
+    /* Insertion sort, there are only a handful */
+    for (x = 0; x < SENSOR_MEDIAN_SAMPLES; x++)
+    {
+        code = pFilter->recent[x];
+        for (y = x; (y > 0) && (sorted[y - 1] > code); y--)
+        {
+            sorted[y] = sorted[y - 1];
+        }
+        sorted[y] = code;
+    }
+
+    return sorted[SENSOR_MEDIAN_SAMPLES / 2];
+}
+
+/* Take a new raw ADC code through a sensor's filters: spike rejection, then smoothing,
+ * then detection with hysteresis so that something on the edge of range doesn't come
+ * and go.  Returns the distance in mm, 0 for nothing there. */
+static unsigned int filterUpdate (SensorFilter * pFilter, unsigned int code)
+{
+    unsigned int smoothedCode;
+
+    pFilter->recent[pFilter->pos] = code;
+    pFilter->pos++;
+    if (pFilter->pos >= SENSOR_MEDIAN_SAMPLES)
+    {
+        pFilter->pos = 0;
+    }
+
+    pFilter->smoothedX16 += ((int) (medianCode (pFilter) << 4) - (int) pFilter->smoothedX16) / (1 << SENSOR_IIR_SHIFT);
+    smoothedCode = (pFilter->smoothedX16 + 8) >> 4;
+
+    if (pFilter->detected)
+    {
+        if (smoothedCode < SHARP_DATA_FIRST_CODE)
+        {
+            pFilter->detected = false;
+        }
+    }
+    else
+    {
+        if (smoothedCode >= SHARP_DATA_FIRST_CODE + SENSOR_DETECT_HYSTERESIS_CODES)
+        {
+            pFilter->detected = true;
+        }
+    }
+
+    return pFilter->detected ? adcToDistanceMm (smoothedCode) : 0;
+}
+
+/* Start a sensor's filters off as if it had always read code */
+static void filterPrime (SensorFilter * pFilter, unsigned int code)
+{
+    unsigned char x;
+
+    for (x = 0; x < SENSOR_MEDIAN_SAMPLES; x++)
+    {
+        pFilter->recent[x] = code;
+    }
+    pFilter->pos = 0;
+    pFilter->smoothedX16 = code << 4;
+    pFilter->detected = (code >= SHARP_DATA_FIRST_CODE + SENSOR_DETECT_HYSTERESIS_CODES);
+    pFilter->numInTheWay = 0;
+}
 
+/* Whether a sensor faces the way that a wheel it watches over is heading */
+static bool isFacingTravel (unsigned char channel, const int * pTargetMmS)
+{
+    unsigned char guards = gSensorGuards[channel];
+    bool backwards = ((guards & SENSOR_GUARDS_BACKWARDS) != 0);
+    bool facing = false;
+
+    if (guards & SENSOR_GUARDS_LEFT)
+    {
+        facing = backwards ? (pTargetMmS[WHEEL_LEFT] < 0) : (pTargetMmS[WHEEL_LEFT] > 0);
+    }
+    if (!facing && (guards & SENSOR_GUARDS_RIGHT))
+    {
+        facing = backwards ? (pTargetMmS[WHEEL_RIGHT] < 0) : (pTargetMmS[WHEEL_RIGHT] > 0);
+    }
+
+    return facing;
+}
+
+/* Take a sensor's latest raw ADC code through the obstacle reflex.  Returns true when
+ * it has had something in the way, no further than thresholdMm (never, if that is
+ * zero), for SENSOR_REFLEX_READINGS readings in a row. */
+static bool reflexUpdate (SensorFilter * pFilter, unsigned char channel, unsigned int code, const int * pTargetMmS, unsigned int thresholdMm)
+{
+    unsigned int distanceMm = adcToDistanceMm (code);
+
+    if (distanceMm > 0 && distanceMm <= thresholdMm && isFacingTravel (channel, pTargetMmS))
+    {
+        if (pFilter->numInTheWay == 0)
+        {
+            pFilter->xInTheWayTick = xTaskGetTickCount();
+        }
+        if (pFilter->numInTheWay < SENSOR_REFLEX_READINGS)
+        {
+            pFilter->numInTheWay++;
+        }
+    }
+    else
+    {
+        pFilter->numInTheWay = 0;
+    }
+
+    return (pFilter->numInTheWay >= SENSOR_REFLEX_READINGS);
+}
+
+/* Tell the far end that the obstacle reflex has braked, e.g. "EVENT obstacle FF 62" */
+static void sendObstacleEvent (unsigned char channel, unsigned int distanceMm)
+{
+    char eventString[EVENT_STRING_LEN];
+
+    strcpy (eventString, "EVENT obstacle ");
+    strcat (eventString, channelToString[channel]);
+    strcat (eventString, " ");
+    utoa (distanceMm, &eventString[RobStrlen (eventString)], 10);
+    sendUnsolicitedString (eventString, RobStrlen (eventString) + 1);
+}
+
+/* A distance in mm as the whole cm that the sensor replies give, 0 staying 0 */
+static unsigned char mmToCm (unsigned int distanceMm)
+{
+    return (unsigned char) ((distanceMm + 5) / 10);
+}
+
+/* The hex digit for the bottom four bits of value */
+static char hexDigit (unsigned char value)
+{
+    value &= 0x0F;
+
+    return (value < 10) ? '0' + value : 'A' + value - 10;
+}
+
+/* Send a telemetry frame if one is due, building it straight into a comms buffer
+ * from the filtered distances, which the transmit task then sends as it is */
+static void telemetryUpdate (void)
+{
+    unsigned int periodMs;
+    unsigned char deltaCm;
+    bool restart;
+    unsigned char cm[MAX_NUM_ADCS];
+    bool send;
+    char * pFrame;
+    unsigned char x;
+
+    portENTER_CRITICAL();
+    {
+        periodMs = gTelemetryPeriodMs;
+        deltaCm = gTelemetryDeltaCm;
+        restart = gTelemetryRestart;
+        gTelemetryRestart = false;
+        for (x = 0; x < MAX_NUM_ADCS; x++)
+        {
+            cm[x] = mmToCm (gSensorDistanceMm[x]);
+        }
+    }
+    portEXIT_CRITICAL();
+
+    if (periodMs == 0)
+    {
+        return;
+    }
+
+    if (gTelemetryMsSinceFrame < periodMs || gTelemetryMsSinceFrame < TELEMETRY_KEEPALIVE_MS)
+    {
+        gTelemetryMsSinceFrame += SENSOR_FILTER_PERIOD_MS;
+    }
+    send = restart;
+    if (!send && gTelemetryMsSinceFrame >= periodMs)
+    {
+        send = (deltaCm == 0) || (gTelemetryMsSinceFrame >= TELEMETRY_KEEPALIVE_MS);
+        for (x = 0; !send && x < MAX_NUM_ADCS; x++)
+        {
+            /* Something coming or going counts, however near the edge of range */
+            send = ((cm[x] == 0) != (gTelemetrySentCm[x] == 0)) ||
+                   (cm[x] >= gTelemetrySentCm[x] + deltaCm) ||
+                   (cm[x] + deltaCm <= gTelemetrySentCm[x]);
+        }
+    }
+
+    if (send)
+    {
+        /* If the pool is empty or the transmit queue full the frame is dropped, and
+         * counted, but the next one will carry the news just the same */
+        pFrame = allocCommsBuffer();
+        if (pFrame != PNULL)
+        {
+            pFrame[0] = TELEMETRY_FRAME_START;
+            for (x = 0; x < MAX_NUM_ADCS; x++)
+            {
+                pFrame[1 + x * 2] = hexDigit (cm[x] >> 4);
+                pFrame[2 + x * 2] = hexDigit (cm[x]);
+            }
+            pFrame[1 + MAX_NUM_ADCS * 2] = 0;
+            sendUnsolicitedCommsBuffer (pFrame);
+        }
+        RobMemcpy (gTelemetrySentCm, cm, sizeof (gTelemetrySentCm));
+        gTelemetryMsSinceFrame = 0;
+    }
+}
+
+/* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
+
+/* Set the ADCs sampling in the background, so that reading them doesn't mean waiting on
+ * conversions.  The readings are raw codes against the X2's regulated 5 V, which is what
+ * the distance table is made for, so they need no calibration. */
+void sensorInit (void)
+{
+    rob_start_analog_background_sampling (MAX_NUM_ADCS);
+}
+
+/* The sensor filter task: runs at a fixed rate, taking the latest reading of each
+ * distance sensor through its filters, so that what they make of it is always there
+ * to be had at once.  It is also the obstacle reflex: should a sensor facing the way
+ * the robot is going see something within the obstacle distance (a calibration
+ * setting, zero for off) it brakes there and then, rather than waiting on the far
+ * end, and tells the far end with an unsolicited "EVENT" line.  Homing backs right up
+ * to the charger, so the reflex stands down while it's under way. */
+void vTaskSensorFilter (void *pvParameters)
+{
+    portTickType xWakeTime;
+    unsigned int distanceMm;
+    unsigned int code;
+    unsigned int thresholdMm;
+    int targetMmS[NUM_WHEELS];
+    unsigned char x;
+
+    xWakeTime = xTaskGetTickCount();
+    while (1)
+    {
+        vTaskDelayUntil (&xWakeTime, SENSOR_FILTER_PERIOD_MS / portTICK_RATE_MS);
+
+        thresholdMm = isHomeInProgress() ? 0 : getCalibration (CAL_OBSTACLE_MM);
+        getWheelTargets (targetMmS);
+
+        for (x = 0; x < MAX_NUM_ADCS; x++)
+        {
+            code = readAdc (x);
+            if (!gSensorFiltersPrimed)
+            {
+                filterPrime (&gSensorFilter[x], code);
+            }
+            distanceMm = filterUpdate (&gSensorFilter[x], code);
+
+            portENTER_CRITICAL();
+            {
+                gSensorDistanceMm[x] = distanceMm;
+            }
+            portEXIT_CRITICAL();
+
+            if (reflexUpdate (&gSensorFilter[x], x, code, targetMmS, thresholdMm))
+            {
+                faultStop();
+                recordReflexLatency ((portTickType) (xTaskGetTickCount() - gSensorFilter[x].xInTheWayTick) * portTICK_RATE_MS);
+                sendObstacleEvent (x, adcToDistanceMm (code));
+                /* Braked now, so nothing else is in the way */
+                RobMemset (targetMmS, 0, sizeof (targetMmS));
+            }
+        }
+        gSensorFiltersPrimed = true;
+
+        telemetryUpdate();
+    }
+}
+
+/* Get what the filters make of a distance sensor, in mm, 0 for nothing there; any
+ * task may call this */
+unsigned int getSensorDistanceMm (unsigned char channel)
+{
+    unsigned int distanceMm;
+
+    ASSERT_PARAM (channel < MAX_NUM_ADCS, channel);
+
+    portENTER_CRITICAL();
+    {
+        distanceMm = gSensorDistanceMm[channel];
+    }
+    portEXIT_CRITICAL();
+
+    return distanceMm;
+}
+
+/* Start sending sensor telemetry frames every periodMs, at least, or stop them if it
+ * is zero.  With a deltaCm only frames in which a sensor has moved by that much (or
+ * something has come or gone) are sent, plus one every so often to show that all is
+ * well.  Returns false if periodMs is faster than the serial link can carry. */
+bool setSensorTelemetry (unsigned int periodMs, unsigned char deltaCm)
+{
+    if (periodMs > 0 && periodMs < TELEMETRY_MIN_PERIOD_MS)
+    {
+        return false;
+    }
+
+    portENTER_CRITICAL();
+    {
+        gTelemetryPeriodMs = periodMs;
+        gTelemetryDeltaCm = deltaCm;
+        gTelemetryRestart = true;
+    }
+    portEXIT_CRITICAL();
+
+    return true;
+}
+
 /* The queue that the sensor reading task uses */
 extern xQueueHandle xSensorCommandQueue;
 
@@ -143,21 +496,20 @@ void vTaskSensor (void *pvParameters)
         {
             case '*': /* The only sensor command supported at the moment */
             {
-                RobMemset (sendString, ' ', sizeof (sendString));
-                calibrateAdcs();
+                RobMemset (sendString, ' ', sizeof (sendString));
                 for (x = 0; x < MAX_NUM_ADCS; x++)
                 {
-                    unsigned int milliVolts;
+                    unsigned int distanceMm;
                     
                     /* Write something like "FL:40  " (for ADC 2 of 6 (which is Front Left), object detected at 40 cm),
                        or "FL:    " if nothing is there. */
                     memcpy (&sendString[ADC_READING_STRING_LEN * x], channelToString[x], SENSOR_STRING_LEN);
                     memcpy (&sendString[(ADC_READING_STRING_LEN * x) + SENSOR_STRING_LEN], NOTHING_THERE_STRING, NOTHING_THERE_STRING_LEN);
                     
-                    milliVolts = readAdc (x);
-                    if (objectDetected (milliVolts))
-                    {
-                        itoa (voltageToDistance (milliVolts), &(sendString[(ADC_READING_STRING_LEN * x) + SENSOR_STRING_LEN + 1]), 10); /* +1 to leave the ':' there */
+                    distanceMm = getSensorDistanceMm (x);
+                    if (distanceMm > 0)
+                    {
+                        itoa ((distanceMm + 5) / 10, &(sendString[(ADC_READING_STRING_LEN * x) + SENSOR_STRING_LEN + 1]), 10); /* +1 to leave the ':' there */
                     }                    
                     
                     /* Overwrite the null terminator that itoa() puts in with a space */
@@ -178,7 +530,7 @@ void vTaskSensor (void *pvParameters)
 
         if (!success)
         {
-            sendSerialString (ERROR_STRING, sizeof (ERROR_STRING));
+            sendSerialResponse (COMMS_RESPONSE_ERROR);
         }
     }
 }
\ No newline at end of file
@@ -8,4 +8,11 @@
  * Author: Rob Meades
  */
 
-void vTaskSensor (void *pvParameters);
\ No newline at end of file
+/* The number of distance sensors, on ADC channels 0 on */
+#define MAX_NUM_ADCS 6
+
+void sensorInit (void);
+void vTaskSensorFilter (void *pvParameters);
+unsigned int getSensorDistanceMm (unsigned char channel);
+void vTaskSensor (void *pvParameters);
+bool setSensorTelemetry (unsigned int periodMs, unsigned char deltaCm);
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <rob_system.h>
 #include <rob_wrappers.h>
 #include <FreeRTOS.h>
+#include <task.h>
 
 #define ASSERT_TUNE "!L16 V8 dc#"
 
@@ -32,6 +33,11 @@ void endStuff (void)
  * This function doesn't actually return. */
 bool assertFunc (const char * pPlace, int line, const char * pText, int param1)
 {
+    /* Nothing else gets to run from here on, and the mutexes the rob_ functions would
+     * take may be held by a task that never will, so go round them: interrupts stay on
+     * for the buzzer */
+    vTaskSuspendAll();
+    rob_panic();
     rob_clear();
     if (pText)
     {
@@ -52,9 +58,10 @@ bool assertFunc (const char * pPlace, int line, const char * pText, int param1)
         rob_print_character (' ');
         rob_print_unsigned_long (param1);
     }
+    endStuff ();
+    rob_lcd_flush(); /* The LCD flush task won't run again */
     rob_wait_play_from_program_space (PSTR(ASSERT_TUNE));  // Play some warning notes.
 
-    endStuff ();
     while (1);
 
     return false;
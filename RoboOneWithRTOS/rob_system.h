@@ -8,7 +8,9 @@
  *  Author: Rob Meades
  */
 
-#ifdef WIN32
+#ifdef ROB_HOST
+#include <rob_hoststubs.h>
+#elif defined (WIN32)
 #include <rob_win32stubs.h>
 #else
 #include <stdbool.h>
@@ -26,10 +28,30 @@
 #define OK_STRING "OK"
 #define ERROR_STRING "ERROR"
 
+#define COMMS_RECEIVE_QUEUE_SIZE 8 /* Defined here because the comms buffer pool is sized from them */
+#define COMMS_TRANSMIT_QUEUE_SIZE 8
 #define MOTION_COMMAND_QUEUE_SIZE 8 /* Defined here because of queue message length checking workaround on rob_processing.c */
 #define SENSOR_COMMAND_QUEUE_SIZE 8
 #define HOME_EVENT_QUEUE_SIZE 8
 
+/* The tasks, which main.c creates and keeps the handles of in xTaskHandles[] */
+typedef enum TaskIdTag
+{
+    TASK_MOTION = 0,
+    TASK_MOTION_CONTROL,
+    TASK_HOME,
+    TASK_SENSOR,
+    TASK_SENSOR_FILTER,
+    TASK_CURRENT_MONITOR,
+    TASK_PROCESSING,
+    TASK_COMMS_TRANSMIT,
+    TASK_COMMS_RECEIVE,
+    TASK_BUZZER,
+    TASK_LCD_FLUSH,
+    TASK_LATENCY_PROBE,
+    NUM_TASKS
+} TaskId;
+
 #define PNULL (void *) NULL
 #define ASSERT_ALWAYS_STRING(sTRING) ((assertFunc (__FUNCTION__, __LINE__, PSTR(sTRING), 0)))
 #define ASSERT_ALWAYS_PARAM(pARAM1) ((assertFunc (__FUNCTION__, __LINE__, PNULL, (pARAM1))))
@@ -8,7 +8,11 @@
  *  Author: Rob Meades
  */
 
-/* So, OK, this is utter overkill but I don't know what to trust in the Pololu library yet so I want to be safe */
+/* The Pololu library isn't thread safe so each peripheral that more than one task uses is
+ * guarded by its own mutex (see RobResource): tasks using different peripherals don't hold
+ * each other up and the mutexes' priority inheritance stops a low priority task that is part
+ * way through, say, printing from holding off a high priority one for longer than the print
+ * takes.  The scheduler is never suspended. */
 
 #include <pololu/orangutan.h>
 
@@ -19,11 +23,29 @@
 
 #include <FreeRTOS.h>
 #include <task.h>
+#include <queue.h>
+#include <semphr.h>
 
 #define ASSERT_TUNE "!L16 V8 dc#"
 
+/* In libRobPololu but not in the installed Pololu headers */
+void serial_set_receive_callback (unsigned char port, SerialReceiveCallback callback);
+void serial_set_send_callback (unsigned char port, SerialSendCallback callback);
+void buzzer_set_done_callback (BuzzerDoneCallback callback);
+
 #define LCD_COL_MAX 15
 #define LCD_ROW_MAX 3
+#define LCD_FLUSH_PERIOD_MS 50 /* How often the LCD flush task sends changes to the display */
+#define TUNE_QUEUE_SIZE 4
+#define TUNE_DONE_CHECK_MS 100 /* Backstop in case a tune ends without the done callback, e.g. if it was stopped */
+
+/* A tune waiting to be played by the buzzer task */
+typedef struct TuneRequestTag
+{
+    const char * pSequence;          /* In program space, or a RobMalloc()ed copy that the buzzer task frees */
+    bool inProgramSpace;
+    xSemaphoreHandle xDoneSemaphore; /* Given when the tune has finished, may be PNULL */
+} TuneRequest;
 
 /* - GLOBALS -------------------------------------------------------------------------- */
 
@@ -31,10 +53,33 @@
 static unsigned int gCursorPosCol = 0;
 static unsigned int gCursorPosRow = 0;
 
+/* One mutex per shared peripheral, indexed by RobResource */
+static xSemaphoreHandle xResourceMutex[NUM_ROB_RESOURCES];
+
+/* The rob_ LCD functions only write to this copy of the display, under ROB_RESOURCE_LCD;
+ * a bit set in gLcdDirty[row] marks a column whose character the display hasn't been sent
+ * yet.  The LCD flush task takes it from there, so printing costs a few byte stores
+ * rather than a few milliseconds of waiting on the HD44780. */
+static char gLcdFrame[LCD_ROW_MAX + 1][LCD_COL_MAX + 1];
+static unsigned int gLcdDirty[LCD_ROW_MAX + 1];
+
+/* Held while talking to the display itself, so that a flush from an assert can't
+ * interleave with one from the LCD flush task */
+static xSemaphoreHandle xLcdFlushMutex;
+
+/* Set by rob_panic(), after which no mutex is taken */
+static volatile bool gPanic = false;
+
+/* Tunes waiting for the buzzer task */
+static xQueueHandle xTuneQueue;
+
+/* Given by the buzzer's note sequencer when it falls silent */
+static xSemaphoreHandle xTuneDoneSemaphore;
+
 /* - STATIC FUNCTIONS ----------------------------------------------------------------- */
 
 /* Move the cursor on the LCD display on, wrapping as necessary */
-void moveCursorOn (int numChars)
+static void moveCursorOn (int numChars)
 {
     gCursorPosCol++;
     if (gCursorPosCol > LCD_COL_MAX)
@@ -46,11 +91,149 @@ void moveCursorOn (int numChars)
             gCursorPosRow = 0;
         }
     }
-    lcd_goto_xy (gCursorPosCol, gCursorPosRow);
+}
+
+/* Put a character into the frame buffer, marking the cell dirty if it has changed */
+static void writeCell (unsigned int col, unsigned int row, char c)
+{
+    if (col <= LCD_COL_MAX && row <= LCD_ROW_MAX && gLcdFrame[row][col] != c)
+    {
+        gLcdFrame[row][col] = c;
+        gLcdDirty[row] |= 1U << col;
+    }
+}
+
+/* Print a character with wrapping, the LCD mutex must be held */
+static void printCharacter (char c)
+{
+    writeCell (gCursorPosCol, gCursorPosRow, c);
+    moveCursorOn (1);
+}
+
+/* This function use to just call the Pololu print_unsigned_long() function
+ * but that doesn't cope with line wrap; the LCD mutex must be held */
+static void printUnsignedLong (unsigned long value)
+{
+    unsigned char str[10];
+    unsigned char i = 10;
+
+    unsigned char digit;
+
+    do
+    {
+        digit = value;
+        value /= 10;
+        digit -= value * 10;
+        str[--i] = '0' + (unsigned char)digit;
+    }
+    while (value != 0);
+
+    for(; i < 10; i++)
+    {
+        printCharacter (str[i]);
+    }
+}
+
+/* Called from the timer1 overflow interrupt when the buzzer's note sequencer has
+ * played the last note */
+static void tuneDoneCallback (void)
+{
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+    xSemaphoreGiveFromISR (xTuneDoneSemaphore, &xHigherPriorityTaskWoken);
+    if (xHigherPriorityTaskWoken)
+    {
+        taskYIELD();
+    }
+}
+
+/* Put a tune on the queue for the buzzer task, freeing it if it is a copy and can't go */
+static bool queueTune (TuneRequest * pRequest)
+{
+    bool success;
+
+    success = (xQueueSend (xTuneQueue, pRequest, 0) == pdPASS);
+    if (!success && !pRequest->inProgramSpace)
+    {
+        RobFree ((void *) pRequest->pSequence);
+    }
+
+    return success;
+}
+
+/* Wait for the buzzer to finish, the buzzer mutex must be held.  Once the scheduler is
+ * running the wait lets other tasks, whatever their priority, get on with things */
+static void waitPlaying (void)
+{
+    while (is_playing())
+    {
+        if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+        {
+            vTaskDelay (1);
+        }
+    }
 }
 
 /* - PUBLIC FUNCTIONS ----------------------------------------------------------------- */
 
+/* Create the peripheral mutexes, must be called before any of the rob_ functions */
+void wrappersInit (void)
+{
+    unsigned char x;
+
+    for (x = 0; x < NUM_ROB_RESOURCES; x++)
+    {
+        xResourceMutex[x] = xSemaphoreCreateMutex();
+        ASSERT_PARAM (xResourceMutex[x], x);
+    }
+    xLcdFlushMutex = xSemaphoreCreateMutex();
+    ASSERT_STRING (xLcdFlushMutex, "Could not create xLcdFlushMutex");
+    xTuneQueue = xQueueCreate (TUNE_QUEUE_SIZE, sizeof (TuneRequest));
+    ASSERT_STRING (xTuneQueue, "Could not create xTuneQueue");
+    vSemaphoreCreateBinary (xTuneDoneSemaphore);
+    ASSERT_STRING (xTuneDoneSemaphore, "Could not create xTuneDoneSemaphore");
+    xSemaphoreTake (xTuneDoneSemaphore, 0); /* Binary semaphores are created "given" */
+    buzzer_set_done_callback (tuneDoneCallback);
+
+    /* The display starts out blank */
+    RobMemset (gLcdFrame, ' ', sizeof (gLcdFrame));
+}
+
+/* Wait for, and take, the mutex for a peripheral.  A task that needs more than one
+ * must take them in the order of RobResource to avoid deadlock. */
+void lockResource (RobResource resource)
+{
+    if (!gPanic)
+    {
+        xSemaphoreTake (xResourceMutex[resource], portMAX_DELAY);
+    }
+}
+
+/* Give back a peripheral taken with lockResource() */
+void unlockResource (RobResource resource)
+{
+    if (!gPanic)
+    {
+        xSemaphoreGive (xResourceMutex[resource]);
+    }
+}
+
+/* For when things have gone too wrong to carry on, e.g. the stack overflow hook: whoever
+ * holds a peripheral's mutex may never give it back, so from here on the rob_ functions
+ * take none and the next rob_lcd_flush() sends the whole frame buffer straight to the
+ * display.  The caller must already have stopped everything else running, by disabling
+ * interrupts or suspending the scheduler. */
+void rob_panic (void)
+{
+    unsigned char row;
+
+    gPanic = true;
+    for (row = 0; row <= LCD_ROW_MAX; row++)
+    {
+        gLcdDirty[row] = (1U << (LCD_COL_MAX + 1)) - 1;
+    }
+}
+
 /* Wrappers for standard library functions that might not be thread safe */
 /* Don't call these directly, call their macros in rob_wrappers.h so that we
 ** can swap between std library and wrapped functions */
@@ -61,13 +244,13 @@ void _RobPrintf (char * pFmt, ...)
 {
     va_list args;
 
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_LCD);
     {
         va_start (args, pFmt);
         vprintf (pFmt, args);
         va_end (args);
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_LCD);
 }
 #endif
 
@@ -81,271 +264,425 @@ void _RobFree (void * pPtr)
    vPortFree (pPtr);
 }
 
-size_t _RobStrlen (const char * pPtr)
+/* Queue a tune to be played by the buzzer task after any already queued and return
+ * straight away.  The tune is copied so pSequence needn't outlive the call.  If
+ * xDoneSemaphore is not PNULL it is given when the tune has finished.  Returns false
+ * if the queue is full or there's no memory for the copy. */
+bool rob_play (const char * pSequence, xSemaphoreHandle xDoneSemaphore)
 {
-    size_t len;
+    TuneRequest request;
+    size_t size = RobStrlen (pSequence) + 1;
+    char * pCopy;
 
-    vTaskSuspendAll();
+    pCopy = RobMalloc (size);
+    if (pCopy == PNULL)
     {
-        len = strlen (pPtr);
+        return false;
     }
-    xTaskResumeAll();
+    RobMemcpy (pCopy, pSequence, size);
+    request.pSequence = pCopy;
+    request.inProgramSpace = false;
+    request.xDoneSemaphore = xDoneSemaphore;
 
-    return len;
+    return queueTune (&request);
 }
 
-void * _RobMemset (void * pPtr, int value, size_t size)
+/* As rob_play() but for a tune in program space, which isn't copied */
+bool rob_play_from_program_space (const char * pSequence, xSemaphoreHandle xDoneSemaphore)
 {
-    void * pReturnPtr;
+    TuneRequest request;
 
-    vTaskSuspendAll();
-    {
-        pReturnPtr = memset (pPtr, value, size);
-    }
-    xTaskResumeAll();
+    request.pSequence = pSequence;
+    request.inProgramSpace = true;
+    request.xDoneSemaphore = xDoneSemaphore;
 
-    return pReturnPtr;
+    return queueTune (&request);
 }
 
-void * _RobMemcpy (void * destPtr, void const * sourcePtr, size_t size)
+/* The buzzer task: plays queued tunes one after the other, sleeping while each plays */
+void vTaskBuzzer (void *pvParameters)
 {
-    void * pReturnPtr;
+    TuneRequest request;
+    portBASE_TYPE xStatus;
 
-    vTaskSuspendAll();
+    while (1)
     {
-        pReturnPtr = memcpy(destPtr, sourcePtr, size);
-    }
-    xTaskResumeAll();
+        xStatus = xQueueReceive (xTuneQueue, &request, portMAX_DELAY);
 
-    return pReturnPtr;
+        ASSERT_STRING (xStatus == pdPASS, "Failed to receive from tune queue.");
+
+        xSemaphoreTake (xTuneDoneSemaphore, 0); /* Clear out any stale completion */
+        lockResource (ROB_RESOURCE_BUZZER);
+        {
+            if (request.inProgramSpace)
+            {
+                play_from_program_space (request.pSequence);
+            }
+            else
+            {
+                play (request.pSequence);
+            }
+        }
+        unlockResource (ROB_RESOURCE_BUZZER);
+
+        while (is_playing())
+        {
+            xSemaphoreTake (xTuneDoneSemaphore, TUNE_DONE_CHECK_MS / portTICK_RATE_MS);
+        }
+
+        if (!request.inProgramSpace)
+        {
+            RobFree ((void *) request.pSequence);
+        }
+        if (request.xDoneSemaphore != PNULL)
+        {
+            xSemaphoreGive (request.xDoneSemaphore);
+        }
+    }
 }
 
-/* Wrappers for Pololu functions that may not be thread safe or like being delayed/swapped-out */
+/* Wrappers for Pololu functions that may not be thread safe.  On the X2 the USB_COMM
+ * serial port and the motors are on the auxiliary processor, at the far end of the SPI
+ * link, so anything that talks to them holds ROB_RESOURCE_SPI while it does so. */
 void rob_wait_play (const char * pSequence)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_BUZZER);
     {
         play (pSequence);
-        while (is_playing())
-        {
-        }
+        waitPlaying();
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_BUZZER);
 }
 
 void rob_wait_play_from_program_space (const char * pSequence)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_BUZZER);
     {
         play_from_program_space (pSequence);
-        while (is_playing())
-        {
-        }
+        waitPlaying();
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_BUZZER);
 }
 
 void rob_lcd_init_printf (void)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_LCD);
     {
         lcd_init_printf();
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_LCD);
 }
 
 void rob_clear (void)
 {
-    vTaskSuspendAll();
+    unsigned int col;
+    unsigned int row;
+
+    lockResource (ROB_RESOURCE_LCD);
     {
         gCursorPosCol = 0;
         gCursorPosRow = 0;
-        clear();
+        for (row = 0; row <= LCD_ROW_MAX; row++)
+        {
+            for (col = 0; col <= LCD_COL_MAX; col++)
+            {
+                writeCell (col, row, ' ');
+            }
+        }
+    }
+    unlockResource (ROB_RESOURCE_LCD);
+}
+
+/* Send whatever has changed in the frame buffer to the display.  Runs of changed
+ * cells in a row go out after a single cursor move.  The frame buffer is only
+ * locked while a row is copied so printing is never held up by the display. */
+void rob_lcd_flush (void)
+{
+    char rowCopy[LCD_COL_MAX + 1];
+    unsigned int dirty;
+    unsigned char col;
+    unsigned char row;
+    bool cursorInPlace;
+
+    if (!gPanic)
+    {
+        xSemaphoreTake (xLcdFlushMutex, portMAX_DELAY);
+    }
+    {
+        for (row = 0; row <= LCD_ROW_MAX; row++)
+        {
+            lockResource (ROB_RESOURCE_LCD);
+            {
+                dirty = gLcdDirty[row];
+                gLcdDirty[row] = 0;
+                RobMemcpy (rowCopy, gLcdFrame[row], sizeof (rowCopy));
+            }
+            unlockResource (ROB_RESOURCE_LCD);
+
+            cursorInPlace = false;
+            for (col = 0; dirty != 0; col++, dirty >>= 1)
+            {
+                if (dirty & 1)
+                {
+                    if (!cursorInPlace)
+                    {
+                        lcd_goto_xy (col, row);
+                        cursorInPlace = true;
+                    }
+                    print_character (rowCopy[col]);
+                }
+                else
+                {
+                    cursorInPlace = false;
+                }
+            }
+        }
+    }
+    if (!gPanic)
+    {
+        xSemaphoreGive (xLcdFlushMutex);
+    }
+}
+
+/* The LCD flush task */
+void vTaskLcdFlush (void *pvParameters)
+{
+    portTickType xWakeTime;
+
+    xWakeTime = xTaskGetTickCount();
+    while (1)
+    {
+        vTaskDelayUntil (&xWakeTime, LCD_FLUSH_PERIOD_MS / portTICK_RATE_MS);
+        rob_lcd_flush();
     }
-    xTaskResumeAll();
 }
 
 void rob_serial_send_usb_comm (char * pBuffer, unsigned char size)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_SERIAL);
+    lockResource (ROB_RESOURCE_SPI);
     {
         serial_send (USB_COMM, pBuffer, size);
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_SPI);
+    unlockResource (ROB_RESOURCE_SERIAL);
 }
 
 void rob_serial_send_blocking_usb_comm (char * pBuffer, unsigned char size)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_SERIAL);
+    lockResource (ROB_RESOURCE_SPI);
     {
         serial_send_blocking (USB_COMM, pBuffer, size);
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_SPI);
+    unlockResource (ROB_RESOURCE_SERIAL);
 }
 
 void rob_serial_check (void)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_SERIAL);
+    lockResource (ROB_RESOURCE_SPI);
     {
         serial_check();
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_SPI);
+    unlockResource (ROB_RESOURCE_SERIAL);
 }
 
 void rob_serial_set_baud_rate_usb_comm (unsigned long baud)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_SERIAL);
+    lockResource (ROB_RESOURCE_SPI);
     {
         serial_set_baud_rate (USB_COMM, baud);
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_SPI);
+    unlockResource (ROB_RESOURCE_SERIAL);
 }
 
 void rob_serial_receive_ring_usb_comm (char * pBuffer, unsigned char size)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_SERIAL);
     {
         serial_receive_ring (USB_COMM, pBuffer, size);
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_SERIAL);
 }
 
 unsigned char rob_serial_get_received_bytes_usb_comm (void)
 {
     unsigned char numBytes;
 
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_SERIAL);
     {
         numBytes = serial_get_received_bytes (USB_COMM);
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_SERIAL);
 
     return numBytes;
 }
 
+void rob_serial_set_receive_callback_usb_comm (SerialReceiveCallback callback)
+{
+    lockResource (ROB_RESOURCE_SERIAL);
+    {
+        serial_set_receive_callback (USB_COMM, callback);
+    }
+    unlockResource (ROB_RESOURCE_SERIAL);
+}
+
+void rob_serial_set_send_callback_usb_comm (SerialSendCallback callback)
+{
+    lockResource (ROB_RESOURCE_SERIAL);
+    {
+        serial_set_send_callback (USB_COMM, callback);
+    }
+    unlockResource (ROB_RESOURCE_SERIAL);
+}
+
 void rob_wait_serial_send_buffer_empty_usb_comm ()
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_SERIAL);
     {
         while (!serial_send_buffer_empty (USB_COMM))
         {
         }
     }
-    xTaskResumeAll();
-}
-
-void rob_print_character_no_suspend (char c)
-{
-    print_character (c);
-    moveCursorOn (1);    
+    unlockResource (ROB_RESOURCE_SERIAL);
 }
 
 void rob_print_character (char c)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_LCD);
     {
-        print_character (c);
-        moveCursorOn (1);
+        printCharacter (c);
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_LCD);
 }
 
 void rob_print (const char * pStr)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_LCD);
     {
         while (*pStr != 0)
         {
-            rob_print_character_no_suspend (*pStr);
+            printCharacter (*pStr);
             pStr++;
         }
-        
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_LCD);
 }
 
 void rob_print_from_program_space (const char * pStr)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_LCD);
     {
-	    char c;
-	    while ((c = pgm_read_byte (pStr)) != 0)
-	    {
-    	    rob_print_character_no_suspend (c);
-    	    pStr++;
-	    }
+        char c;
+        while ((c = pgm_read_byte (pStr)) != 0)
+        {
+            printCharacter (c);
+            pStr++;
+        }
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_LCD);
 }
 
-/* This function use to just call the Pololu print_long() function
- * but that doesn't cope with line wrap */
 void rob_print_long (long value)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_LCD);
     {
         if (value < 0)
         {
             value = -value;
-            rob_print_character_no_suspend ('-'); // print the minus sign
+            printCharacter ('-'); // print the minus sign
         }
-        rob_print_unsigned_long ((unsigned long) value);
+        printUnsignedLong ((unsigned long) value);
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_LCD);
 }
 
-/* This function use to just call the Pololu print_unsigned_long() function
- * but that doesn't cope with line wrap */
 void rob_print_unsigned_long (unsigned long value)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_LCD);
     {
-        unsigned char str[10];
-        unsigned char i = 10;
-
-        unsigned char digit;
-
-        do
-        {
-            digit = value;
-            value /= 10;
-            digit -= value * 10;
-            str[--i] = '0' + (unsigned char)digit;
-        }
-        while (value != 0);
-
-        for(; i < 10; i++)
-        {
-            rob_print_character_no_suspend (str[i]);            
-        }
+        printUnsignedLong (value);
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_LCD);
 }
 
 void rob_lcd_goto_xy (int col, int row)
 {
-    vTaskSuspendAll();
+    lockResource (ROB_RESOURCE_LCD);
     {
-        lcd_goto_xy (col, row);
         gCursorPosCol = col;
         gCursorPosRow = row;
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_LCD);
 }
 
-unsigned int rob_read_vcc_millivolts()
+/* Hand the ADC over to sampling channels 0 to numChannels - 1 in the background, from
+ * its interrupt.  From then on the ADC belongs to the sampler: the readings, raw codes,
+ * come from analog_read_background_average(), which needs no lock, and nothing may
+ * start a conversion of its own. */
+void rob_start_analog_background_sampling (unsigned char numChannels)
 {
-    unsigned int supplyVolts;
+    lockResource (ROB_RESOURCE_ADC);
+    {
+        start_analog_background_sampling (numChannels);
+    }
+    unlockResource (ROB_RESOURCE_ADC);
+}
 
-    vTaskSuspendAll();
+void rob_x2_set_motor (unsigned char motor, unsigned char operation, int speed)
+{
+    lockResource (ROB_RESOURCE_SPI);
     {
-        supplyVolts = read_vcc_millivolts();
+        x2_set_motor (motor, operation, speed);
     }
-    xTaskResumeAll();
+    unlockResource (ROB_RESOURCE_SPI);
+}
 
-    return supplyVolts;
+/* Set both motors in one SPI burst, so that they change together */
+void rob_x2_set_motors (unsigned char m1Operation, int m1Speed, unsigned char m2Operation, int m2Speed)
+{
+    lockResource (ROB_RESOURCE_SPI);
+    {
+        x2_set_motors (m1Operation, m1Speed, m2Operation, m2Speed);
+    }
+    unlockResource (ROB_RESOURCE_SPI);
 }
 
+/* Read both motors' currents, MOTOR1 then MOTOR2, into pCurrents, taking the SPI
+ * link once for the pair */
+void rob_x2_get_motor_currents (unsigned char * pCurrents)
+{
+    lockResource (ROB_RESOURCE_SPI);
+    {
+        pCurrents[MOTOR1] = x2_get_motor_current (MOTOR1);
+        pCurrents[MOTOR2] = x2_get_motor_current (MOTOR2);
+    }
+    unlockResource (ROB_RESOURCE_SPI);
+}
 
+void rob_x2_save_eeprom_byte (unsigned int address, unsigned char data)
+{
+    lockResource (ROB_RESOURCE_SPI);
+    {
+        x2_save_eeprom_byte (address, data);
+    }
+    unlockResource (ROB_RESOURCE_SPI);
+}
 
+unsigned char rob_x2_read_eeprom_byte (unsigned int address)
+{
+    unsigned char data;
+
+    lockResource (ROB_RESOURCE_SPI);
+    {
+        data = x2_read_eeprom_byte (address);
+    }
+    unlockResource (ROB_RESOURCE_SPI);
 
+    return data;
+}
\ No newline at end of file
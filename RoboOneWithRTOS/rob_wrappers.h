@@ -13,6 +13,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <semphr.h>
+
 #if 0
     //#define RobPrintf printf
 #    define RobPrintf _RobPrintf
@@ -27,28 +31,52 @@ void * _RobMalloc (size_t size);
 #define RobFree _RobFree
 void _RobFree (void * ptr);
 
+/* These only touch the memory they are given, so they are reentrant as they stand */
 #define RobStrlen strlen
-//#define RobStrlen _RobStrlen
-//size_t _RobStrlen (const char * ptr);
-
 #define RobMemset memset
-//#define RobMemset _RobMemset
-//void * _RobMemset (void * ptr, int value, size_t size);
-
 #define RobMemcpy memcpy
-//#define RobMemcpy _RobMemcpy
-//void * _RobMemcpy (void * destPtr, void const * sourcePtr, size_t size);
+#define RobMemmove memmove
+
+/* The peripherals that more than one task uses, each guarded by its own mutex.  If a task
+ * needs more than one it must lock them in this order. */
+typedef enum RobResourceTag
+{
+    ROB_RESOURCE_LCD = 0,
+    ROB_RESOURCE_BUZZER,
+    ROB_RESOURCE_ADC,
+    ROB_RESOURCE_SERIAL,
+    ROB_RESOURCE_SPI, /* The link to the X2's auxiliary processor, which handles USB_COMM and the motors */
+    NUM_ROB_RESOURCES
+} RobResource;
+
+/* Added to OrangutanSerial in PololuLibs, not in the installed Pololu headers */
+typedef void (*SerialReceiveCallback) (unsigned char port, unsigned char byteReceived);
+typedef void (*SerialSendCallback) (unsigned char port);
+
+/* Added to OrangutanBuzzer in PololuLibs, not in the installed Pololu headers */
+typedef void (*BuzzerDoneCallback) (void);
 
+void wrappersInit (void);
+void lockResource (RobResource resource);
+void unlockResource (RobResource resource);
+void rob_panic (void);
+bool rob_play (const char * pSequence, xSemaphoreHandle xDoneSemaphore);
+bool rob_play_from_program_space (const char * pSequence, xSemaphoreHandle xDoneSemaphore);
+void vTaskBuzzer (void *pvParameters);
 void rob_wait_play (const char * pSequence);
 void rob_wait_play_from_program_space (const char * pSequence);
 void rob_lcd_init_printf (void);
 void rob_clear (void);
+void rob_lcd_flush (void);
+void vTaskLcdFlush (void *pvParameters);
 void rob_serial_send_usb_comm (char * pBuffer, unsigned char size);
 void rob_serial_send_blocking_usb_comm (char * pBuffer, unsigned char size);
 void rob_serial_check (void);
 void rob_serial_set_baud_rate_usb_comm (unsigned long baud);
 void rob_serial_receive_ring_usb_comm (char * pBuffer, unsigned char size);
 unsigned char rob_serial_get_received_bytes_usb_comm (void);
+void rob_serial_set_receive_callback_usb_comm (SerialReceiveCallback callback);
+void rob_serial_set_send_callback_usb_comm (SerialSendCallback callback);
 void rob_wait_serial_send_buffer_empty_usb_comm (void);
 void rob_print_character (char c);
 void rob_print (const char * pStr);
@@ -56,4 +84,9 @@ void rob_print_from_program_space (const char * pStr);
 void rob_print_long (long value);
 void rob_print_unsigned_long (unsigned long value);
 void rob_lcd_goto_xy (int col, int row);
-unsigned int rob_read_vcc_millivolts (void);
\ No newline at end of file
+void rob_start_analog_background_sampling (unsigned char numChannels);
+void rob_x2_set_motor (unsigned char motor, unsigned char operation, int speed);
+void rob_x2_set_motors (unsigned char m1Operation, int m1Speed, unsigned char m2Operation, int m2Speed);
+void rob_x2_get_motor_currents (unsigned char * pCurrents);
+void rob_x2_save_eeprom_byte (unsigned int address, unsigned char data);
+unsigned char rob_x2_read_eeprom_byte (unsigned int address);
\ No newline at end of file
@@ -0,0 +1,22 @@
+/* Sharp data - distance table for the GP2Y0A41SK0F sensors of an application for the Pololu Orangutan X2
+ *
+ * GENERATED by host/gen_sharp_data.py from the data sheet's curve, don't edit:
+ * change the script and run it again.
+ */
+
+#include <rob_system.h>
+#include <sharp_data.h>
+
+/* The distance in mm at ADC code SHARP_DATA_FIRST_CODE + (index << SHARP_DATA_STEP_SHIFT) */
+const unsigned int gSharpDataMm[SHARP_DATA_SIZE] PROGMEM =
+{
+    398, 350, 315, 287, 262, 242, 226, 211, /* 78 */
+    199, 187, 177, 167, 158, 150, 143, 137, /* 142 */
+    131, 126, 121, 116, 112, 108, 104, 101, /* 206 */
+     98,  94,  92,  89,  86,  83,  81,  79, /* 270 */
+     76,  74,  72,  70,  69,  67,  65,  64, /* 334 */
+     62,  61,  59,  58,  56,  55,  54,  53, /* 398 */
+     52,  51,  50,  48,  47,  46,  45,  44, /* 462 */
+     44,  43,  42,  41,  40,  39,  39,  38, /* 526 */
+     37,  36,  36,  35  /* 590 */
+};
@@ -0,0 +1,13 @@
+/* Sharp data - distance table for the GP2Y0A41SK0F sensors of an application for the Pololu Orangutan X2
+ *
+ * GENERATED by host/gen_sharp_data.py from the data sheet's curve, don't edit:
+ * change the script and run it again.
+ */
+
+#define SHARP_DATA_FIRST_CODE 78 /* The ADC code at 400 mm; below it there is nothing there */
+#define SHARP_DATA_LAST_CODE 614  /* The ADC code at 35 mm; at and above it, read as that */
+#define SHARP_DATA_MIN_MM 35
+#define SHARP_DATA_STEP_SHIFT 3  /* An entry every 1 << this ADC codes */
+#define SHARP_DATA_SIZE 68
+
+extern const unsigned int gSharpDataMm[SHARP_DATA_SIZE];
\ No newline at end of file
@@ -1,11 +1,25 @@
-unsigned int  distances = {10,20,40,80,100,200,300,400,500,600,700,800,900,1000};
-/* 10,20,40,80,100,200,300,400,500,600,700,800,900,1000 */
-unsigned int  factors = {161,153,140,122,116,103,101,99,98,98,99,98,102,128}; /* 60 */
-{208,185,150,108,98,87,90,86,84,87,85,85,167,567}; /* 90 */
-{103,100,97,91,89,84,82,81,80,80,80,80,79,81}; /* 120 */
-{225,199,157,106,93,80,83,79,77,80,78,79,175,644}; /* 150 */
-{244,215,169,113,98,82,85,80,78,81,79,80,183,686}; /* 180 */
-{133,128,120,107,102,89,85,83,82,82,82,82,80,75}; /* 210 */
-{163,155,141,120,113,94,88,86,85,85,85,85,88,108}; /* 240 */
-{182,171,153,127,118,96,90,87,86,86,86,86,93,135}; /* 255 */
-unsigned int  speeds = {60,90,120,150,180,210,240,255};
+/* Speed data - measured speed correction factors for an application for the Pololu Orangutan X2
+ *
+ * GENERATED by host/gen_speed_data.py from "Robot Speed Data.xlsx", don't edit:
+ * change the spreadsheet and run the script again.
+ */
+
+#include <rob_system.h>
+#include <speed_data.h>
+
+/* The speeds, in O units, that the factors were measured at */
+const unsigned int gSpeedDataSpeeds[SPEED_DATA_NUM_SPEEDS] PROGMEM = {60, 90, 117, 180, 225, 255};
+
+/* The distances, in cm, that the factors were measured over */
+const unsigned int gSpeedDataDistances[SPEED_DATA_NUM_DISTANCES] PROGMEM = {10, 20, 40, 80, 100, 200, 300, 400};
+
+/* Commanded over actual distance, in hundredths (50 to 255), by speed then distance */
+const unsigned char gSpeedDataFactors[SPEED_DATA_NUM_SPEEDS][SPEED_DATA_NUM_DISTANCES] PROGMEM =
+{
+    {200, 154, 143, 121, 114, 105, 102, 100}, /* 60 */
+    {255, 154, 125, 114,  93,  88,  87,  85}, /* 90 */
+    {255, 200, 121, 104,  90,  85,  83,  82}, /* 117 */
+    {255, 255, 174, 116,  95,  85,  82,  81}, /* 180 */
+    {255, 255, 255, 138, 105,  90,  85,  84}, /* 225 */
+    {255, 255, 255, 160, 119,  97,  91,  88}  /* 255 */
+};
@@ -0,0 +1,12 @@
+/* Speed data - measured speed correction factors for an application for the Pololu Orangutan X2
+ *
+ * GENERATED by host/gen_speed_data.py from "Robot Speed Data.xlsx", don't edit:
+ * change the spreadsheet and run the script again.
+ */
+
+#define SPEED_DATA_NUM_SPEEDS 6
+#define SPEED_DATA_NUM_DISTANCES 8
+
+extern const unsigned int gSpeedDataSpeeds[SPEED_DATA_NUM_SPEEDS];
+extern const unsigned int gSpeedDataDistances[SPEED_DATA_NUM_DISTANCES];
+extern const unsigned char gSpeedDataFactors[SPEED_DATA_NUM_SPEEDS][SPEED_DATA_NUM_DISTANCES];
\ No newline at end of file